@@ -0,0 +1,290 @@
+//BENCHMARK OF THE GILLESPIE KERNELS ACROSS MODES, TEMPERATURES AND SEQUENCE LENGTHS
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <random>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+#include <sys/resource.h>
+
+#include "energy.hpp"
+#include "engine.hpp"
+#include "batch.hpp"
+#include "rng.hpp"
+
+struct Options {
+    std::string steps = "10000000";
+    std::string lengths = "20,36,100,500,2000";
+    std::string kernels = "scalar,batch,reference";
+    std::string seed = "1";
+    std::string out;
+};
+
+Options parseParams(int argc, char* argv[]);
+
+struct Workload {
+    std::string mode;
+    std::string table;
+    std::string structure;
+    std::string seq;
+};
+
+struct Measurement {
+    long events = 0;
+    long steps = 0;
+    double seconds = 0.0;
+};
+
+// Fixed-seed random sequence of len bases in which no k-mer repeats, 4^k >= 4 len: a repeat is
+// a misregistered duplex that can live for ~10^6 s at 37C, so random sequences with long
+// repeats would make the workload arbitrarily slow. Stem-loop sequences have their middle fifth
+// in lowercase, like the stem-loop of AAGATGGTGAGTgccatcttAAAACTTACTGGAGAT.
+std::string makeSequence(int len, bool stemLoop, std::uint64_t seed) {
+    int k = 1;
+    while ((1L << (2*k)) < 4L*len) k++;
+    std::uint64_t x = seed*1000003 + len;
+    std::vector<bool> used(1L << (2*k), false);
+    std::string seq;
+    long kmer = 0;
+    while (int(seq.size()) < len) {
+        int base = splitMix64(x) & 3;
+        // try the four bases from a random one, restart the sequence when all repeat a k-mer
+        bool extended = false;
+        for (int i = 0; i < 4 && !extended; i++) {
+            int b = (base + i) & 3;
+            long next = ((kmer << 2) | b) & ((1L << (2*k)) - 1);
+            if (int(seq.size()) + 1 >= k && used[next]) continue;
+            if (int(seq.size()) + 1 >= k) used[next] = true;
+            kmer = next;
+            seq += "ACGT"[b];
+            extended = true;
+        }
+        if (!extended) {
+            seq.clear();
+            kmer = 0;
+            used.assign(used.size(), false);
+        }
+    }
+    if (stemLoop) {
+        for (int i = 2*len/5; i < 3*len/5; i++) seq[i] = char(std::tolower(seq[i]));
+    }
+    return seq;
+}
+
+long maxRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// The engine and the batch kernel on one workload for a budget of maxSteps steps, events
+// recorded into a running sum
+template <class Sim, class Nucleation, class EnergyModel>
+Measurement runKernel(const Workload& w, const EnergyModel& model, long maxSteps,
+                      double time, std::uint64_t seed, std::size_t& tableBytes) {
+    RateTable rates = buildRateTable(model, packSequence(w.seq), pow(10, 9));
+    tableBytes = rates.bytes();
+    Nucleation nucleation(rates, 1, rates.len);
+    Sim simulation(rates, nucleation, time);
+    simulation.maxSteps = maxSteps;
+    Xoshiro256pp mt(seed, 0);
+    double sum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    long done = simulation.run(std::numeric_limits<long>::max(), mt, [&sum](int, double t) { sum += t; });
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (sum < 0.0) printf("unreachable\n");
+    return {done, simulation.steps, elapsed.count()};
+}
+
+// Reference kernel: the loop of the original per-mode programs, with energies from the if-else
+// cascade, getParams and exp for every step and two uniforms per step from default_random_engine,
+// for a budget of maxSteps steps
+template <double (*getEnergy)(int, int, int, int)>
+Measurement runReference(const Workload& w, int num1, int num2, long maxSteps, double time, std::uint64_t seed) {
+    std::vector<int> s1, s2;
+    encodeSequence(w.seq, s1, s2);
+    int len = w.seq.size();
+    const bool registryMode = w.mode == "registry";
+    const bool failedMode = w.mode == "failed";
+
+    double kForm = pow(10, 9);
+    double t = 0.0;
+    int xL = 0; int xR = 0;
+    int yL = 0; int yR = 0;
+    int hBonds = 0;
+    long success = 0;
+    long steps = 0;
+    std::default_random_engine mt(seed);
+    std::uniform_int_distribution<int> distInt(registryMode ? 1 : num1, registryMode ? len : num2);
+    std::uniform_real_distribution<double> dist01(0, 1);
+    double sum = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (t < time) {
+        steps++;
+        if (xL == 0 && xR == 0) {
+            int x, y;
+            while (true) {
+                x = distInt(mt);
+                y = registryMode ? distInt(mt) : x;
+                if (!registryMode || x != y) break;
+            }
+            xL = x; xR = x;
+            yL = y; yR = y;
+            hBonds = 1;
+            double r2 = dist01(mt);
+            double kTotal = len*len*kForm;
+            t += (-1.0/kTotal) * log(1.0 - r2);
+        }
+        else {
+            double randNum = dist01(mt);
+            double r2 = dist01(mt);
+            double kB1 = kForm*exp(getEnergy(s2[yL - 1], s1[xL - 1], s2[yL], s1[xL]));
+            double kB2 = (xR == xL) ? 0.0 : kForm*exp(getEnergy(s2[yR - 1], s1[xR - 1], s2[yR], s1[xR]));
+            int rMax = getParams(yL, xL, len).first;
+            int lMin = getParams(yL, xL, len).second;
+            double kFL = (xL == lMin) ? 0.0 : kForm;
+            double kFR = (xR == rMax) ? 0.0 : kForm;
+            double kTotal = kB1 + kB2 + kFL + kFR;
+            if (randNum <= kB1/kTotal) {
+                xL++; yL++; hBonds--;
+            } else if (randNum <= (kB1 + kB2)/kTotal) {
+                xR--; yR--; hBonds--;
+            } else if (randNum <= (kB1 + kB2 + kFL)/kTotal) {
+                xL--; yL--; hBonds++;
+            } else {
+                xR++; yR++; hBonds++;
+            }
+            if (hBonds == 0) {
+                xR = xL = 0;
+                yR = yL = 0;
+            }
+            t += (-1.0/kTotal) * log(1.0 - r2);
+        }
+        bool melted = hBonds == 0 && xL == 0;
+        bool zipped = !registryMode && hBonds == len;
+        if ((registryMode || failedMode) ? melted : zipped) {
+            sum += t;
+            success++;
+            t = 0;
+        } else if (failedMode && zipped) {
+            t = 0;
+        }
+        if (zipped) {
+            xR = xL = 0;
+            yR = yL = 0;
+            hBonds = 0;
+        }
+        if (steps == maxSteps) break;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (sum < 0.0) printf("unreachable\n");
+    return {success, steps, elapsed.count()};
+}
+
+template <class EnergyModel, double (*getEnergy)(int, int, int, int), class Nucleation, class Absorption>
+void runWorkload(const Workload& w, const Options& options, FILE* out, bool& first) {
+    long steps = std::stol(options.steps);
+    std::uint64_t seed = std::stoull(options.seed);
+    int len = w.seq.size();
+    // every kernel takes the same number of steps, which bounds the heavy-tailed 37C registry
+    // times of long sequences; the time caps are those of the simulation programs
+    double time = (w.mode == "registry" && w.table == "37C") ? 1000000.0 : 10000000.0;
+
+    std::stringstream kernels(options.kernels);
+    for (std::string kernel; std::getline(kernels, kernel, ',');) {
+        Measurement m;
+        std::size_t tableBytes = 0;
+        if (kernel == "scalar") {
+            m = runKernel<Simulation<EnergyModel, Nucleation, Absorption>, Nucleation>(w, EnergyModel{}, steps, time, seed, tableBytes);
+        } else if (kernel == "batch") {
+            m = runKernel<BatchSimulation<EnergyModel, Nucleation, Absorption, 8>, Nucleation>(w, EnergyModel{}, steps, time, seed, tableBytes);
+        } else if (kernel == "reference") {
+            m = runReference<getEnergy>(w, 1, len, steps, time, seed);
+        } else {
+            continue;
+        }
+        // a rate of 0 events would compare nothing
+        if (m.events == 0) {
+            throw std::runtime_error(w.mode + " " + w.table + " " + w.structure + " " + std::to_string(len) + " " + kernel +
+                                     ": no events within --steps " + options.steps);
+        }
+        fprintf(out, "%s\n    {\"mode\": \"%s\", \"table\": \"%s\", \"structure\": \"%s\", \"length\": %i, \"kernel\": \"%s\", "
+                     "\"events\": %li, \"steps\": %li, \"seconds\": %.6f, \"events_per_second\": %.1f, \"ns_per_step\": %.3f, "
+                     "\"rate_table_bytes\": %zu, \"max_rss_kb\": %li}",
+                first ? "" : ",", w.mode.c_str(), w.table.c_str(), w.structure.c_str(), len, kernel.c_str(),
+                m.events, m.steps, m.seconds, m.events/m.seconds, 1e9*m.seconds/std::max(m.steps, 1L), tableBytes, maxRssKb());
+        fflush(out);
+        first = false;
+        fprintf(stderr, "%s %s %s %i %s: %.3f s\n", w.mode.c_str(), w.table.c_str(), w.structure.c_str(), len, kernel.c_str(), m.seconds);
+    }
+}
+
+template <class EnergyModel, double (*getEnergy)(int, int, int, int)>
+void runTable(const Workload& w, const Options& options, FILE* out, bool& first) {
+    if (w.mode == "registry") runWorkload<EnergyModel, getEnergy, MisregisteredNucleation, RegistryAbsorption>(w, options, out, first);
+    if (w.mode == "successful") runWorkload<EnergyModel, getEnergy, InRegistryNucleation, SuccessfulAbsorption>(w, options, out, first);
+    if (w.mode == "failed") runWorkload<EnergyModel, getEnergy, InRegistryNucleation, FailedAbsorption>(w, options, out, first);
+}
+
+int main(int argc, char* argv[]) {
+
+    Options options = parseParams(argc, argv);
+
+    FILE* out = options.out.empty() ? stdout : fopen(options.out.c_str(), "w");
+    if (!out) {
+        printf("Error: cannot open %s\n", options.out.c_str());
+        return 1;
+    }
+
+    std::vector<int> lengths;
+    std::stringstream list(options.lengths);
+    for (std::string item; std::getline(list, item, ',');) lengths.push_back(std::stoi(item));
+
+    fprintf(out, "{\n  \"benchmark\": \"kDNA\",\n  \"compiler\": \"%s\",\n  \"seed\": %s,\n  \"steps\": %s,\n  \"results\": [",
+            __VERSION__, options.seed.c_str(), options.steps.c_str());
+    bool first = true;
+    for (std::string mode : {"registry", "successful", "failed"}) {
+        for (std::string table : {"37C", "55C"}) {
+            for (std::string structure : {"unstructured", "stem-loop"}) {
+                // a nucleus next to a stem-loop takes far more than any step budget to zip or melt,
+                // so stem-loops are benchmarked by their misregistered duplexes only
+                if (structure == "stem-loop" && mode != "registry") continue;
+                for (int len : lengths) {
+                    Workload w{mode, table, structure, makeSequence(len, structure == "stem-loop", std::stoull(options.seed))};
+                    try {
+                        if (table == "37C") runTable<Energy37C, getEnergyReference37C>(w, options, out, first);
+                        else runTable<Energy55C, getEnergyReference55C>(w, options, out, first);
+                    } catch (const std::runtime_error& e) {
+                        fprintf(out, "\n  ]\n}\n");
+                        if (out != stdout) fclose(out);
+                        printf("Error: %s\n", e.what());
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+Options parseParams(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string temp(argv[i]);
+        if (temp == "--steps") options.steps = std::string (argv[i + 1]);
+        if (temp == "--lengths") options.lengths = std::string (argv[i + 1]);
+        if (temp == "--kernels") options.kernels = std::string (argv[i + 1]);
+        if (temp == "--seed") options.seed = std::string (argv[i + 1]);
+        if (temp == "--out") options.out = std::string (argv[i + 1]);
+    }
+    return options;
+}
@@ -0,0 +1,1203 @@
+//GILLESPIE SIMULATION OF REGISTRY TIME, SUCCESSFUL ZIPPING TIME AND FAILED ZIPPING TIME
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <fstream>
+
+#include "energy.hpp"
+#include "engine.hpp"
+#include "runner.hpp"
+#include "batch.hpp"
+#include "output.hpp"
+#include "stats.hpp"
+#include "solver.hpp"
+#include "sequences.hpp"
+#include "checkpoint.hpp"
+#include "nucleation.hpp"
+#include "pool.hpp"
+#include "trajectory.hpp"
+#include "ffs.hpp"
+#include "sites.hpp"
+#include "shard.hpp"
+
+struct Options {
+    std::string seq;
+    std::string stop;
+    std::string mode = "registry";
+    std::string table = "37C";
+    std::string num1;
+    std::string num2;
+    std::string temp;
+    std::string nnParams;
+    std::string seed;
+    std::string threads;
+    std::string batch;
+    std::string rng = "xoshiro";
+    std::string out;
+    std::string format = "text";
+    std::string summary;
+    std::string method = "gillespie";
+    std::string times;
+    std::string seqFile;
+    std::string checkpoint;
+    std::string checkpointEvery = "60";
+    std::string resume;
+    std::string precision;
+    std::string precisionBy = "all";
+    std::string nucleation = "uniform";
+    std::string kform = "1e9";
+    std::string sweep;
+    std::string trace;
+    std::string traceLevel = "moves";
+    std::string replay;
+    std::string event = "0";
+    std::string interfaces = "10";
+    std::string shard;
+};
+
+// Event k of block b of a run, simulated again by --replay
+struct EventPosition {
+    long block = 0;
+    long index = 0;
+};
+
+// Where the events of a run go: the event writer and/or the --summary statistics and the
+// --precision stop rule, saved with the position of the run by --checkpoint; replay (may be
+// null) asks for the path of one event instead
+struct RunOutput {
+    OutputWriter* events = nullptr;
+    SummaryCollector* summary = nullptr;
+    std::string energy;
+    Checkpoint* checkpoint = nullptr;
+    PrecisionRule* precision = nullptr;
+    const EventPosition* replay = nullptr;
+};
+
+Options parseParams(int argc, char* argv[]);
+
+// Nucleation window [--num1, --num2] of a sequence of len bases, the whole sequence by default
+inline std::pair<int, int> nucleationWindow(const Options& options, int len) {
+    int num1 = 1, num2 = len;
+    try {
+        if (!options.num1.empty()) num1 = std::stoi(options.num1);
+        if (!options.num2.empty()) num2 = std::stoi(options.num2);
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("--num1 and --num2 must be positions");
+    }
+    if (num1 < 1 || num2 > len || num1 > num2) {
+        throw std::runtime_error("nucleation window [" + std::to_string(num1) + ", " + std::to_string(num2) + "] outside 1.." + std::to_string(len));
+    }
+    return {num1, num2};
+}
+
+// --rng xoshiro (default, fastest) or philox (counter-based, streams provably disjoint)
+template <class Sim, class Emit, class Progress>
+int runRng(const Options& options, const Sim& simulation, long stopCondition, std::uint64_t seed,
+           std::uint64_t streamBase, int threads, Emit& emit, long firstBlock, Progress& progress) {
+    if (options.rng == "xoshiro") runEnsemble<Xoshiro256pp>(simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+    else if (options.rng == "philox") runEnsemble<Philox>(simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+    else {
+        printf("Error: unknown --rng %s (xoshiro or philox)\n", options.rng.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// --replay of a positions trace: simulates block position.block again with the recorder and
+// writes the path of its event position.index
+template <class Sim>
+int replayEvent(const Options& options, Sim& simulation, const EventPosition& position, std::uint64_t streamBase) {
+    auto replay = [&](auto mt) {
+        simulation.startBlock(position.block);
+        long done = simulation.run(position.index + 1, mt, [](int, double) {});
+        if (done <= position.index) throw std::runtime_error("the replayed block ends before the event");
+        const std::string& records = simulation.recorder.blockRecords();
+        const std::vector<std::uint64_t>& offsets = simulation.recorder.recordOffsets();
+        std::size_t end = std::size_t(position.index) + 1 < offsets.size() ? offsets[position.index + 1] : records.size();
+        writeTrajectory(stdout, records.substr(offsets[position.index], end - offsets[position.index]), "");
+    };
+    std::uint64_t seed = std::stoull(options.seed);
+    if (options.rng == "xoshiro") replay(Xoshiro256pp(seed, streamBase + position.block));
+    else if (options.rng == "philox") replay(Philox(seed, streamBase + position.block));
+    else throw std::runtime_error("unknown rng " + options.rng + " in the trace");
+    fflush(stdout);
+    return 0;
+}
+
+template <class EnergyModel, class Nucleation, class Absorption>
+int runMode(const Options& options, const EnergyModel& model, double time, RunOutput& output, std::uint64_t streamBase) {
+    long stopCondition = std::stol(options.stop);
+    int len = size(options.seq);
+
+    PackedSequence seq = packSequence(options.seq);
+
+    // nucleation window of the zipping modes, the whole sequence by default
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+
+    double kForm = std::stod(options.kform);
+    RateTable rates = Simulation<EnergyModel, Nucleation, Absorption>::buildRates(model, seq, kForm);
+    Nucleation nucleation(rates, randNum1, randNum2);
+
+    std::uint64_t seed = std::stoull(options.seed);
+    int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+
+    if (output.replay) {
+        Simulation<EnergyModel, Nucleation, Absorption, TrajectoryRecorder> simulation(rates, nucleation, time);
+        return replayEvent(options, simulation, *output.replay, streamBase);
+    }
+
+    // --trace FILE records the moves of every event or (--trace-level positions) the block of
+    // each event, with what --replay needs to run it again
+    std::unique_ptr<TraceWriter> trace;
+    if (!options.trace.empty()) {
+        trace = std::make_unique<TraceWriter>(options.trace, options.traceLevel == "moves", kBlockEvents,
+            std::vector<std::pair<std::string, std::string>>{{"mode", options.mode}, {"energy", output.energy}, {"seq", options.seq},
+                {"kform", options.kform}, {"num1", std::to_string(randNum1)}, {"num2", std::to_string(randNum2)},
+                {"seed", options.seed}, {"rng", options.rng}, {"nucleation", options.nucleation}, {"nn-params", options.nnParams},
+                {"stream-base", std::to_string(streamBase)}, {"time", std::to_string(time)}});
+    }
+    TraceWriter* positions = (trace && options.traceLevel != "moves") ? trace.get() : nullptr;
+    long emitted = 0;
+
+    // a resumed run continues after the blocks (and the header) already written
+    long firstBlock = output.checkpoint ? output.checkpoint->firstBlock() : 0;
+    // --shard i/N runs only the blocks of shard i (shard.hpp), so the N shards together run the
+    // blocks and streams of the whole run; shard 0 writes the header
+    if (!options.shard.empty()) {
+        ShardHeader shard = parseShard(options.shard);
+        long blockEvents = options.batch.empty() ? kBlockEvents : kBlockEvents*std::stol(options.batch);
+        auto [first, last] = shardBlocks((stopCondition + blockEvents - 1)/blockEvents, shard.index, shard.count);
+        firstBlock = first;
+        stopCondition = std::min(stopCondition, last*blockEvents);
+    }
+    if (output.events && firstBlock == 0) {
+        output.events->writeHeader({{"mode", options.mode}, {"energy", output.energy}, {"seq", options.seq}, {"stop", options.stop},
+                                    {"num1", std::to_string(randNum1)}, {"num2", std::to_string(randNum2)},
+                                    {"seed", options.seed}, {"rng", options.rng}, {"nucleation", options.nucleation}});
+    }
+    auto emit = [&output, &emitted, positions](int g, double t) {
+        if (positions) positions->position(emitted, g, t);
+        emitted++;
+        if (output.events) output.events->write(g, t);
+        if (output.summary) output.summary->add(g, t);
+        if (output.precision) output.precision->add(g, t);
+    };
+    // after every block: the run ends once --precision is reached, otherwise it may checkpoint
+    auto progress = [&output](long nextBlock) {
+        if (output.precision && output.precision->reached()) return true;
+        if (output.checkpoint) output.checkpoint->blockDone(nextBlock, output.events, output.summary, output.precision);
+        return false;
+    };
+
+    // --batch 4/8/16 advances that many trajectories per thread in lockstep
+    if (options.batch == "4") {
+        BatchSimulation<EnergyModel, Nucleation, Absorption, 4> simulation(rates, nucleation, time);
+        return runRng(options, simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+    } else if (options.batch == "8") {
+        BatchSimulation<EnergyModel, Nucleation, Absorption, 8> simulation(rates, nucleation, time);
+        return runRng(options, simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+    } else if (options.batch == "16") {
+        BatchSimulation<EnergyModel, Nucleation, Absorption, 16> simulation(rates, nucleation, time);
+        return runRng(options, simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+    } else if (options.batch.empty() && trace && !positions) {
+        Simulation<EnergyModel, Nucleation, Absorption, TrajectoryRecorder> simulation(rates, nucleation, time, TrajectoryRecorder(trace.get()));
+        int status = runRng(options, simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+        trace->close(emitted);
+        return status;
+    } else if (options.batch.empty()) {
+        Simulation<EnergyModel, Nucleation, Absorption> simulation(rates, nucleation, time);
+        int status = runRng(options, simulation, stopCondition, seed, streamBase, threads, emit, firstBlock, progress);
+        if (trace) trace->close(emitted);
+        return status;
+    }
+    printf("Error: --batch must be 4, 8 or 16\n");
+    return 1;
+}
+
+template <class EnergyModel>
+int runEnergyModel(const Options& options, const EnergyModel& model, double time, RunOutput& output, std::uint64_t streamBase = 0) {
+    if (options.nucleation == "stability") {
+        // contacts weighted by the stability of their stack (nucleation.hpp)
+        if (options.mode == "registry") return runMode<EnergyModel, StabilityMisregisteredNucleation, RegistryAbsorption>(options, model, time, output, streamBase);
+        if (options.mode == "successful") return runMode<EnergyModel, StabilityInRegistryNucleation, SuccessfulAbsorption>(options, model, time, output, streamBase);
+        if (options.mode == "failed") return runMode<EnergyModel, StabilityInRegistryNucleation, FailedAbsorption>(options, model, time, output, streamBase);
+    }
+    if (options.mode == "registry") return runMode<EnergyModel, MisregisteredNucleation, RegistryAbsorption>(options, model, time, output, streamBase);
+    if (options.mode == "successful") return runMode<EnergyModel, InRegistryNucleation, SuccessfulAbsorption>(options, model, time, output, streamBase);
+    if (options.mode == "failed") return runMode<EnergyModel, InRegistryNucleation, FailedAbsorption>(options, model, time, output, streamBase);
+    printf("Error: unknown --mode %s (registry, successful or failed)\n", options.mode.c_str());
+    return 1;
+}
+
+// Output file of one run: --out (stdout when empty), with suffix inserted before the extension
+std::string outputName(const std::string& out, const std::string& suffix) {
+    if (out.empty() || suffix.empty()) return out;
+    std::size_t dot = out.find_last_of('.');
+    std::size_t slash = out.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return out + suffix;
+    return out.substr(0, dot) + suffix + out.substr(dot);
+}
+
+// --method exact: mean times and zipping probabilities from the first-passage equations of
+// the chain (solver.hpp) instead of sampling, one line per registry and one for all events
+template <class EnergyModel>
+int runExact(const Options& options, const EnergyModel& model, FILE* file, const std::string& prefix, const std::string& energy) {
+    int len = size(options.seq);
+    PackedSequence seq = packSequence(options.seq);
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+    double kForm = std::stod(options.kform);
+    RateTable rates = buildRateTable(model, seq, kForm);
+
+    fprintf(file, "# exact mode %s energy %s seq %s\n", options.mode.c_str(), energy.c_str(), options.seq.c_str());
+    fprintf(file, "# registry weight success duration mean\n");
+    if (options.mode == "registry") {
+        RegistrySolution all;
+        double mean = 0.0;
+        for (auto& s : solveRegistryTimes(rates)) {
+            double registryTime = meanNucleationTime(rates) + s.duration;
+            fprintf(file, "%s%i %.12g %.12g %.12g %.12g\n", prefix.c_str(), s.g, s.weight, s.success, s.duration, registryTime);
+            all.success += s.weight*s.success;
+            all.duration += s.weight*s.duration;
+            mean += s.weight*registryTime;
+        }
+        fprintf(file, "%sall 1 %.12g %.12g %.12g\n", prefix.c_str(), all.success, all.duration, mean);
+    } else if (options.mode == "successful" || options.mode == "failed") {
+        RegistrySolution s = solveRegistry(rates, 0, randNum1, randNum2, true);
+        double mean = options.mode == "successful" ? successfulTime(rates, s) : failedTime(rates, s);
+        fprintf(file, "%sall 1 %.12g %.12g %.12g\n", prefix.c_str(), s.success, s.duration, mean);
+    } else {
+        printf("Error: unknown --mode %s (registry, successful or failed)\n", options.mode.c_str());
+        return 1;
+    }
+    fflush(file);
+    return 0;
+}
+
+// --method committor: probability of zipping fully from every state (xL, xR) of the in-registry
+// chain, solved once (solver.hpp), as lines "state xL xR success", then per nucleation site of
+// [--num1, --num2] as "site x success" and "all success" averaged over the sites, which are
+// weighted by their stability with --nucleation stability
+template <class EnergyModel>
+int runCommittor(const Options& options, const EnergyModel& model, FILE* file, const std::string& prefix, const std::string& energy) {
+    if (options.mode != "successful" && options.mode != "failed") {
+        printf("Error: --method committor needs --mode successful or failed\n");
+        return 1;
+    }
+    int len = size(options.seq);
+    PackedSequence seq = packSequence(options.seq);
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+    RateTable rates = buildRateTable(model, seq, std::stod(options.kform));
+    ChainSolution chain = solveChain(rates, 0, true);
+
+    fprintf(file, "# committor mode %s energy %s seq %s\n", options.mode.c_str(), energy.c_str(), options.seq.c_str());
+    fprintf(file, "# state xL xR success\n");
+    for (int xL = chain.lMin; xL <= chain.rMax; xL++) {
+        for (int xR = xL; xR <= chain.rMax; xR++) {
+            fprintf(file, "%sstate %i %i %.12g\n", prefix.c_str(), xL, xR, chain.zipped[chain.index(xL, xR)]);
+        }
+    }
+    fprintf(file, "# site x success\n");
+    double success = 0.0, weights = 0.0;
+    for (int x = std::max(randNum1, chain.lMin); x <= std::min(randNum2, chain.rMax); x++) {
+        double p = chain.zipped[chain.index(x, x)];
+        double weight = options.nucleation == "stability" ? contactWeight(rates, rates.step1[x]*kStackCodes + rates.step2[x]) : 1.0;
+        fprintf(file, "%ssite %i %.12g\n", prefix.c_str(), x, p);
+        success += weight*p;
+        weights += weight;
+    }
+    fprintf(file, "%sall %.12g\n", prefix.c_str(), weights > 0.0 ? success/weights : 0.0);
+    fflush(file);
+    return 0;
+}
+
+// --method sites: --stop attempts nucleated at every site of [--num1, --num2] in one run
+// (sites.hpp), one line "site attempts success zipped sd melted sd time" per site and an "all"
+// line of the pooled attempts: the zipping probability, the mean and standard deviation of the
+// zipped and melted attempt times (nucleation wait included) and the mean time of the mode for
+// nuclei formed at that site only (the successful or failed zipping time of --num1 = --num2 = x)
+template <class EnergyModel>
+int runSites(const Options& options, const EnergyModel& model, FILE* file, const std::string& prefix, const std::string& energy,
+             std::uint64_t streamBase) {
+    if (options.mode != "successful" && options.mode != "failed") {
+        printf("Error: --method sites needs --mode successful or failed\n");
+        return 1;
+    }
+    int len = size(options.seq);
+    PackedSequence seq = packSequence(options.seq);
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+    RateTable rates = buildRateTable(model, seq, std::stod(options.kform));
+    double kNucleation = options.nucleation == "stability" ? contactRate(rates) : InRegistryNucleation::rate(rates);
+    long attempts = std::stol(options.stop);
+    std::uint64_t seed = std::stoull(options.seed);
+    int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+
+    std::vector<SiteCounters> counters = options.rng == "philox"
+        ? sampleSites<Philox>(rates, randNum1, randNum2, attempts, kNucleation, seed, streamBase, threads)
+        : sampleSites<Xoshiro256pp>(rates, randNum1, randNum2, attempts, kNucleation, seed, streamBase, threads);
+
+    fprintf(file, "# sites mode %s energy %s seq %s seed %s attempts %li\n", options.mode.c_str(), energy.c_str(), options.seq.c_str(),
+            options.seed.c_str(), attempts);
+    fprintf(file, "# site attempts success zipped sd melted sd time\n");
+    auto write = [&](const std::string& site, const SiteCounters& c) {
+        double time = options.mode == "successful" ? c.successfulTime() : c.melted.count ? c.melted.mean : std::nan("");
+        fprintf(file, "%s%s %li %.12g %.12g %.12g %.12g %.12g %.12g\n", prefix.c_str(), site.c_str(), c.attempts(), c.success(),
+                c.zipped.mean, std::sqrt(c.zipped.variance()), c.melted.mean, std::sqrt(c.melted.variance()), time);
+    };
+    SiteCounters all;
+    for (std::size_t k = 0; k < counters.size(); k++) {
+        write(std::to_string(randNum1 + int(k)), counters[k]);
+        all.zipped.merge(counters[k].zipped);
+        all.melted.merge(counters[k].melted);
+    }
+    write("all", all);
+    fflush(file);
+    return 0;
+}
+
+// --method ffs: probability that an in-registry nucleus zips fully by forward flux sampling
+// (ffs.hpp) with --stop trials per interface, one line "interface hBonds trials successes p" per
+// interface and "all flux success error rate", rate being the nucleation rate times the
+// probability of the mode's outcome (zipping in successful mode, melting in failed mode)
+template <class EnergyModel>
+int runFfs(const Options& options, const EnergyModel& model, FILE* file, const std::string& prefix, const std::string& energy,
+           std::uint64_t streamBase) {
+    if (options.mode != "successful" && options.mode != "failed") {
+        printf("Error: --method ffs needs --mode successful or failed\n");
+        return 1;
+    }
+    int len = size(options.seq);
+    PackedSequence seq = packSequence(options.seq);
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+    RateTable rates = buildRateTable(model, seq, std::stod(options.kform));
+    std::vector<int> interfaces = ffsInterfaces(len, std::stoi(options.interfaces));
+    long trials = std::stol(options.stop);
+    std::uint64_t seed = std::stoull(options.seed);
+    int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+
+    auto sample = [&](auto nucleation) {
+        if (options.rng == "philox") return forwardFlux<Philox>(rates, nucleation, interfaces, trials, seed, streamBase, threads);
+        return forwardFlux<Xoshiro256pp>(rates, nucleation, interfaces, trials, seed, streamBase, threads);
+    };
+    FfsResult result = options.nucleation == "stability" ? sample(StabilityInRegistryNucleation(rates, randNum1, randNum2))
+                                                         : sample(InRegistryNucleation(rates, randNum1, randNum2));
+
+    fprintf(file, "# ffs mode %s energy %s seq %s seed %s trials %li\n", options.mode.c_str(), energy.c_str(), options.seq.c_str(),
+            options.seed.c_str(), trials);
+    fprintf(file, "# interface hBonds trials successes p\n");
+    for (std::size_t i = 0; i < result.stages.size(); i++) {
+        const FfsStage& stage = result.stages[i];
+        fprintf(file, "%s%zu %i %li %li %.12g\n", prefix.c_str(), i, stage.lambda, stage.trials, stage.successes, stage.p());
+    }
+    const FfsStage& last = result.stages.back();
+    if (last.successes == 0)
+        fprintf(stderr, "%sffs stage %zu had no successes out of %li trials, increase --stop\n", prefix.c_str(), result.stages.size() - 1,
+                last.trials);
+    double outcome = options.mode == "successful" ? result.success : 1.0 - result.success;
+    fprintf(file, "# flux success error rate\n");
+    fprintf(file, "%sall %.12g %.12g %.6g %.12g\n", prefix.c_str(), result.flux, result.success, result.error, result.flux*outcome);
+    fflush(file);
+    return 0;
+}
+
+// Values of --times, --temp and --kform: a comma-separated list, or first:last:n for n points
+// spaced evenly (on a log scale when logSpaced)
+std::vector<double> parseValues(const std::string& text, bool logSpaced) {
+    std::vector<double> values;
+    if (std::count(text.begin(), text.end(), ':') == 2) {
+        std::stringstream range(text);
+        std::string first, last, n;
+        std::getline(range, first, ':');
+        std::getline(range, last, ':');
+        std::getline(range, n);
+        double a = std::stod(first), b = std::stod(last);
+        if (logSpaced) {
+            a = std::log(a);
+            b = std::log(b);
+        }
+        int points = std::stoi(n);
+        for (int i = 0; i < points; i++) {
+            double value = points == 1 ? a : a + (b - a)*i/(points - 1);
+            values.push_back(logSpaced ? std::exp(value) : value);
+        }
+        return values;
+    }
+    std::stringstream list(text);
+    for (std::string item; std::getline(list, item, ',');) values.push_back(std::stod(item));
+    return values;
+}
+
+// Time grid of --times, log-spaced for first:last:n
+std::vector<double> parseTimes(const std::string& text) { return parseValues(text, true); }
+
+// --method distribution: CDF and PDF of the first-passage time on the --times grid
+// (solver.hpp), lines "registry t cdf pdf" per registry in registry mode and "all t cdf pdf"
+template <class EnergyModel>
+int runDistribution(const Options& options, const EnergyModel& model, FILE* file, const std::string& prefix, const std::string& energy) {
+    int len = size(options.seq);
+    PackedSequence seq = packSequence(options.seq);
+    auto [randNum1, randNum2] = nucleationWindow(options, len);
+    double kForm = std::stod(options.kform);
+    RateTable rates = buildRateTable(model, seq, kForm);
+    std::vector<double> times = parseTimes(options.times);
+
+    fprintf(file, "# distribution mode %s energy %s seq %s\n", options.mode.c_str(), energy.c_str(), options.seq.c_str());
+    fprintf(file, "# registry t cdf pdf\n");
+    PassageDistribution all;
+    all.cdf.assign(times.size(), 0.0);
+    all.pdf.assign(times.size(), 0.0);
+    if (options.mode == "registry") {
+        // registries are independent, --threads solves them in parallel
+        std::vector<RegistrySolution> registries = solveRegistryTimes(rates);
+        std::vector<PassageDistribution> distributions(registries.size());
+        std::atomic<std::size_t> next(0);
+        auto worker = [&]() {
+            for (std::size_t r = next++; r < registries.size(); r = next++) {
+                distributions[r] = passageDistribution(rates, registries[r].g, 1, len, Passage::Melting, times);
+            }
+        };
+        int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; i++) pool.emplace_back(worker);
+        worker();
+        for (auto& thread : pool) thread.join();
+
+        for (std::size_t r = 0; r < registries.size(); r++) {
+            const PassageDistribution& d = distributions[r];
+            for (std::size_t i = 0; i < times.size(); i++) {
+                fprintf(file, "%s%i %.6g %.12g %.12g\n", prefix.c_str(), registries[r].g, times[i], d.cdf[i], d.pdf[i]);
+                all.cdf[i] += registries[r].weight*d.cdf[i];
+                all.pdf[i] += registries[r].weight*d.pdf[i];
+            }
+        }
+    } else if (options.mode == "successful" || options.mode == "failed") {
+        Passage passage = options.mode == "successful" ? Passage::Zipping : Passage::FailedZipping;
+        all = passageDistribution(rates, 0, randNum1, randNum2, passage, times);
+    } else {
+        printf("Error: unknown --mode %s (registry, successful or failed)\n", options.mode.c_str());
+        return 1;
+    }
+    for (std::size_t i = 0; i < times.size(); i++) {
+        fprintf(file, "%sall %.6g %.12g %.12g\n", prefix.c_str(), times[i], all.cdf[i], all.pdf[i]);
+    }
+    fflush(file);
+    return 0;
+}
+
+// Runs one energy model into the event output (skipped with --summary unless --out is given)
+// and the --summary report, whose file is shared by all the runs of a command; checkpoint (may
+// be null) is positioned on the run by the caller
+template <class EnergyModel>
+int runOutputs(const Options& options, const EnergyModel& model, double time, FILE* eventFile, bool binary,
+               const std::string& prefix, FILE* summaryFile, const std::string& energy, Checkpoint* checkpoint,
+               std::uint64_t streamBase = 0) {
+    if (options.method == "exact") return runExact(options, model, eventFile, prefix, energy);
+    if (options.method == "distribution") return runDistribution(options, model, eventFile, prefix, energy);
+    if (options.method == "committor") return runCommittor(options, model, eventFile, prefix, energy);
+    if (options.method == "sites") return runSites(options, model, eventFile, prefix, energy, streamBase);
+    if (options.method == "ffs") return runFfs(options, model, eventFile, prefix, energy, streamBase);
+
+    std::unique_ptr<OutputWriter> events;
+    if (options.summary.empty() || !options.out.empty()) {
+        events = std::make_unique<OutputWriter>(eventFile, binary, options.mode == "registry", prefix);
+    }
+    std::unique_ptr<SummaryCollector> summary;
+    if (summaryFile) summary = std::make_unique<SummaryCollector>(options.mode == "registry");
+    if (summary && checkpoint) checkpoint->restoreSummary(*summary);
+    // --precision-by registry asks every registry (nonzero, from 1 - len to len - 1) for the precision
+    std::unique_ptr<PrecisionRule> precision;
+    if (!options.precision.empty()) {
+        int registries = (options.mode == "registry" && options.precisionBy == "registry") ? 2*int(options.seq.size()) - 2 : 0;
+        precision = std::make_unique<PrecisionRule>(std::stod(options.precision), registries);
+        if (checkpoint) checkpoint->restorePrecision(*precision);
+    }
+
+    RunOutput output{events.get(), summary.get(), energy, checkpoint, precision.get()};
+    int status = runEnergyModel(options, model, time, output, streamBase);
+    events.reset();
+    if (status == 0 && precision) {
+        fprintf(stderr, "%sprecision %.4g%s\n", prefix.c_str(), precision->width(), precision->reached() ? "" : " not reached within --stop");
+    }
+    // a shard saves its partial summary for the merge subcommand instead of the report
+    if (status == 0 && summary) {
+        std::string title = "mode " + options.mode + " energy " + energy + " seq " + options.seq + " seed " + options.seed;
+        if (options.shard.empty()) summary->writeReport(summaryFile, title);
+        else writeShardRun(summaryFile, title, options.mode == "registry", *summary);
+        fflush(summaryFile);
+    }
+    if (status == 0 && checkpoint) checkpoint->runDone();
+    return status;
+}
+
+// Runs every temperature of --temp (comma separated, in C) from dH/dS with the shared energy
+// tables; with more than one temperature every text record starts with its temperature, binary
+// output and --trace go to one file per temperature (runs.bin -> runs_37.bin, runs_55.bin). Records start
+// with tag (the sequence ID of --seq-file). Temperature i is run i of the checkpoint.
+int runTemperatures(const Options& options, EnergyTableCache& cache, FILE* eventFile, FILE* summaryFile, const std::string& tag,
+                    Checkpoint* checkpoint) {
+    std::vector<double> temps = parseValues(options.temp, false);
+
+    bool binary = options.format == "binary";
+    bool writeEvents = options.summary.empty() || !options.out.empty();
+    if (binary && writeEvents && temps.size() > 1 && options.out.empty()) {
+        printf("Error: binary output of several temperatures needs --out\n");
+        return 1;
+    }
+
+    for (std::size_t i = 0; i < temps.size(); i++) {
+        if (checkpoint && checkpoint->done(i)) continue;
+        EnergyNearestNeighbor model{&cache.get(temps[i])};
+        char label[32];
+        snprintf(label, sizeof(label), "%g", temps[i]);
+        std::string prefix = tag + ((temps.size() > 1 && !binary) ? std::string(label) + " " : "");
+        std::unique_ptr<OutputFile> binaryFile;
+        if (writeEvents && binary && temps.size() > 1) {
+            long long keepBytes = (checkpoint && checkpoint->continues(i)) ? checkpoint->eventBytes() : -1;
+            binaryFile = std::make_unique<OutputFile>(outputName(options.out, std::string("_") + label), true, keepBytes);
+        }
+        FILE* file = binaryFile ? binaryFile->get() : eventFile;
+        if (checkpoint) checkpoint->startRun(i, file, !binaryFile, summaryFile);
+        // every temperature draws from its own range of RNG streams and traces to its own file
+        Options run = options;
+        if (temps.size() > 1) run.trace = outputName(options.trace, std::string("_") + label);
+        int status = runOutputs(run, model, 10000000.0, file, binary, prefix,
+                                summaryFile, std::string("nn ") + label + "C", checkpoint, std::uint64_t(i) << 40);
+        if (status != 0) return status;
+    }
+    return 0;
+}
+
+// Runs options.seq at the --temp temperatures (cache set) or with the --table energies into the
+// event and summary files, either of which may be null, saving checkpoints when one is given
+int runSequence(const Options& options, EnergyTableCache* cache, FILE* events, FILE* summary, const std::string& tag,
+                Checkpoint* checkpoint) {
+    if (cache) return runTemperatures(options, *cache, events, summary, tag, checkpoint);
+    if (checkpoint) {
+        if (checkpoint->done(0)) return 0;
+        checkpoint->startRun(0, events, true, summary);
+    }
+
+    // cap on the time of a single event
+    double time = (options.mode == "registry" && options.table == "37C") ? 1000000.0 : 10000000.0;
+
+    bool binary = options.format == "binary";
+    if (options.table == "37C") return runOutputs(options, Energy37C{}, time, events, binary, tag, summary, options.table, checkpoint);
+    if (options.table == "55C") return runOutputs(options, Energy55C{}, time, events, binary, tag, summary, options.table, checkpoint);
+    printf("Error: unknown --table %s (37C or 55C)\n", options.table.c_str());
+    return 1;
+}
+
+// --seq-file: --threads workers take the sequences in file order, simulate each on one thread
+// into memory and the outputs are written in file order, every record starting with the
+// sequence ID. Sequence k runs with the seed SplitMix64(seed + k), shown in its reports, so
+// the output does not depend on the number of threads.
+int runSequenceFile(const Options& options, EnergyTableCache* cache, FILE* events, FILE* summary) {
+    std::vector<SequenceRecord> records = readSequences(options.seqFile);
+    int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+    const std::size_t maxAhead = 4*std::max(threads, 1);
+
+    struct Result {
+        int status = 0;
+        std::string error;
+        std::string events;
+        std::string summary;
+    };
+    // everything a sequence writes goes to a memory stream first
+    auto capture = [](std::string& text, auto&& write) {
+        char* buffer = nullptr;
+        std::size_t size = 0;
+        FILE* stream = open_memstream(&buffer, &size);
+        int status = write(stream);
+        fclose(stream);
+        text.assign(buffer, size);
+        free(buffer);
+        return status;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t next = 0, nextEmit = 0;
+    int status = 0;
+    std::map<std::size_t, Result> pending;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] { return next >= records.size() || status != 0 || next < nextEmit + maxAhead; });
+            if (next >= records.size() || status != 0) return;
+            std::size_t k = next++;
+            lock.unlock();
+
+            Options sequence = options;
+            sequence.seq = records[k].seq;
+            sequence.threads = "1";
+            // the solver methods run without a seed
+            if (!options.seed.empty()) {
+                std::uint64_t seed = std::stoull(options.seed) + k;
+                sequence.seed = std::to_string(splitMix64(seed));
+            }
+            Result result;
+            std::string summaryText;
+            try {
+                result.status = capture(result.events, [&](FILE* eventStream) {
+                    if (!summary) return runSequence(sequence, cache, events ? eventStream : nullptr, nullptr, records[k].id + " ", nullptr);
+                    return capture(result.summary, [&](FILE* summaryStream) {
+                        return runSequence(sequence, cache, events ? eventStream : nullptr, summaryStream, records[k].id + " ", nullptr);
+                    });
+                });
+            } catch (const std::exception& e) {
+                result.status = 1;
+                result.error = e.what();
+            }
+
+            lock.lock();
+            pending[k] = std::move(result);
+            while (!pending.empty() && pending.begin()->first == nextEmit && status == 0) {
+                Result& done = pending.begin()->second;
+                if (events) fwrite(done.events.data(), 1, done.events.size(), events);
+                if (summary) fwrite(done.summary.data(), 1, done.summary.size(), summary);
+                if (done.status != 0) {
+                    status = done.status;
+                    if (!done.error.empty()) printf("Error: %s: %s\n", records[nextEmit].id.c_str(), done.error.c_str());
+                }
+                pending.erase(pending.begin());
+                nextEmit++;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+    if (events) fflush(events);
+    if (summary) fflush(summary);
+    return status;
+}
+
+// One task of --sweep: a sequence with a single mode, energy (--temp or --table) and kForm
+struct SweepTask {
+    std::string id;
+    Options options;
+};
+
+// Adds the tasks of one parameter set, whose --temp, --table, --kform and --mode may be lists:
+// every combination for every sequence of records, in that nesting order
+void addSweepTasks(const Options& set, const std::vector<SequenceRecord>& records, std::vector<SweepTask>& tasks) {
+    auto split = [](const std::string& text) {
+        std::vector<std::string> items;
+        std::stringstream list(text);
+        for (std::string item; std::getline(list, item, ',');) items.push_back(item);
+        return items;
+    };
+    auto label = [](double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%g", value);
+        return std::string(text);
+    };
+    std::vector<std::string> temps, tables, kforms;
+    for (double temp : parseValues(set.temp, false)) temps.push_back(label(temp));
+    if (temps.empty()) tables = split(set.table);
+    for (double kform : parseValues(set.kform, true)) {
+        if (!(kform > 0.0)) throw std::runtime_error("--kform must be positive");
+        kforms.push_back(label(kform));
+    }
+    for (auto& table : tables) {
+        if (table != "37C" && table != "55C") throw std::runtime_error("unknown --table " + table + " (37C or 55C)");
+    }
+    std::vector<std::string> modes = split(set.mode);
+    for (auto& mode : modes) {
+        if (mode != "registry" && mode != "successful" && mode != "failed")
+            throw std::runtime_error("unknown --mode " + mode + " (registry, successful or failed)");
+    }
+
+    for (auto& record : records) {
+        for (std::size_t e = 0; e < temps.size() + tables.size(); e++) {
+            for (auto& kform : kforms) {
+                for (auto& mode : modes) {
+                    SweepTask task{record.id, set};
+                    task.options.seq = record.seq;
+                    if (e < temps.size()) task.options.temp = temps[e];
+                    else task.options.table = tables[e - temps.size()];
+                    task.options.kform = kform;
+                    task.options.mode = mode;
+                    tasks.push_back(task);
+                }
+            }
+        }
+    }
+}
+
+// Tasks of --sweep grid (the command line) or --sweep FILE, whose lines hold key=value
+// parameter sets (keys id, seq, temp, table, kform, mode, num1, num2, '#' starting a comment)
+// over the command line; a set without seq runs the sequences of --seq or --seq-file
+std::vector<SweepTask> sweepTasks(const Options& options) {
+    std::vector<SequenceRecord> records;
+    if (!options.seqFile.empty()) records = readSequences(options.seqFile);
+    else if (!options.seq.empty()) records.push_back({"1", options.seq});
+
+    std::vector<SweepTask> tasks;
+    if (options.sweep == "grid") {
+        if (records.empty()) throw std::runtime_error("--sweep grid needs --seq or --seq-file");
+        addSweepTasks(options, records, tasks);
+        return tasks;
+    }
+    std::ifstream file(options.sweep);
+    if (!file) throw std::runtime_error("cannot open " + options.sweep);
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+        std::istringstream fields(line.substr(0, line.find('#')));
+        Options set = options;
+        std::string id, seq;
+        bool table = false, temp = false, any = false;
+        for (std::string field; fields >> field;) {
+            std::size_t equals = field.find('=');
+            std::string key = field.substr(0, equals), value = equals == std::string::npos ? "" : field.substr(equals + 1);
+            if (key == "id") id = value;
+            else if (key == "seq") seq = value;
+            else if (key == "temp") set.temp = value, temp = true;
+            else if (key == "table") set.table = value, table = true;
+            else if (key == "kform") set.kform = value;
+            else if (key == "mode") set.mode = value;
+            else if (key == "num1") set.num1 = value;
+            else if (key == "num2") set.num2 = value;
+            else throw std::runtime_error("unknown sweep parameter " + field + " in line " + std::to_string(lineNumber) + " of " + options.sweep);
+            any = true;
+        }
+        if (!any) continue;
+        // a table on the line replaces the --temp of the command line
+        if (table && !temp) set.temp.clear();
+        if (seq.empty() && records.empty()) throw std::runtime_error("no seq in line " + std::to_string(lineNumber) + " of " + options.sweep);
+        if (seq.empty()) addSweepTasks(set, records, tasks);
+        else addSweepTasks(set, {{id.empty() ? std::to_string(lineNumber) : id, seq}}, tasks);
+    }
+    return tasks;
+}
+
+// --sweep: every task simulates its events into the summary statistics on a work-stealing
+// pool of --threads workers (runWorkStealing, pool.hpp), the tasks sharing the dH/dS energy
+// table of each temperature, and the result table has one line per task in task order. Task k
+// runs with the seed SplitMix64(seed + k), so the table does not depend on the number of
+// threads; with fewer tasks than threads every task splits its events over the rest.
+int runSweep(const Options& options, EnergyTableCache& cache, FILE* file) {
+    std::vector<SweepTask> tasks = sweepTasks(options);
+    int threads = options.threads.empty() ? 1 : std::stoi(options.threads);
+    std::string taskThreads = std::to_string(std::max<std::size_t>(1, threads/std::max<std::size_t>(tasks.size(), 1)));
+
+    fprintf(file, "# sweep %zu tasks seed %s\n", tasks.size(), options.seed.c_str());
+    fprintf(file, "# task id mode energy temp kform count mean sd min p01 p10 p50 p90 p99 max\n");
+    fflush(file);
+
+    std::mutex mutex;
+    std::size_t nextEmit = 0;
+    int status = 0;
+    std::map<std::size_t, std::string> pending;
+
+    runWorkStealing(tasks.size(), threads, [&](std::size_t k) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (status != 0) return;
+        }
+        Options task = tasks[k].options;
+        std::uint64_t seed = std::stoull(options.seed) + k;
+        task.seed = std::to_string(splitMix64(seed));
+        task.threads = taskThreads;
+
+        bool nn = !task.temp.empty();
+        std::string group = std::to_string(k) + " " + tasks[k].id + " " + task.mode + " " + (nn ? "nn " + task.temp : "table " + task.table.substr(0, 2)) +
+                            " " + task.kform;
+        SummaryCollector summary(false);
+        std::unique_ptr<PrecisionRule> precision;
+        if (!task.precision.empty()) {
+            int registries = (task.mode == "registry" && task.precisionBy == "registry") ? 2*int(task.seq.size()) - 2 : 0;
+            precision = std::make_unique<PrecisionRule>(std::stod(task.precision), registries);
+        }
+        RunOutput output{nullptr, &summary, nn ? "nn " + task.temp + "C" : task.table, nullptr, precision.get()};
+        int result = 1;
+        std::string error, row;
+        try {
+            if (nn) {
+                result = runEnergyModel(task, EnergyNearestNeighbor{&cache.get(std::stod(task.temp))}, 10000000.0, output);
+            } else {
+                double time = (task.mode == "registry" && task.table == "37C") ? 1000000.0 : 10000000.0;
+                if (task.table == "37C") result = runEnergyModel(task, Energy37C{}, time, output);
+                else result = runEnergyModel(task, Energy55C{}, time, output);
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (result == 0) {
+            char* buffer = nullptr;
+            std::size_t size = 0;
+            FILE* stream = open_memstream(&buffer, &size);
+            summary.writeAll(stream, group);
+            fclose(stream);
+            row.assign(buffer, size);
+            free(buffer);
+            if (precision) fprintf(stderr, "%s precision %.4g%s\n", group.c_str(), precision->width(), precision->reached() ? "" : " not reached within --stop");
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result != 0) {
+            if (status == 0 && !error.empty()) printf("Error: task %zu (%s): %s\n", k, tasks[k].id.c_str(), error.c_str());
+            status = result;
+            return;
+        }
+        pending[k] = std::move(row);
+        while (status == 0 && !pending.empty() && pending.begin()->first == nextEmit) {
+            fputs(pending.begin()->second.c_str(), file);
+            pending.erase(pending.begin());
+            nextEmit++;
+        }
+        fflush(file);
+    });
+    return status;
+}
+
+// Options a checkpoint is only valid for: everything that changes the output except the seed,
+// which is checked on its own (--threads does not change the output)
+std::string checkpointKey(const Options& options) {
+    return "seq=" + options.seq + "\nstop=" + options.stop + "\nmode=" + options.mode + "\ntable=" + options.table +
+           "\nnum1=" + options.num1 + "\nnum2=" + options.num2 + "\ntemp=" + options.temp + "\nnn-params=" + options.nnParams +
+           "\nbatch=" + options.batch + "\nrng=" + options.rng + "\nout=" + options.out + "\nformat=" + options.format +
+           "\nsummary=" + options.summary + "\nprecision=" + options.precision + "\nprecision-by=" + options.precisionBy + "\nnucleation=" + options.nucleation + "\nkform=" + options.kform + "\n";
+}
+
+// Options the shards of one command share: everything that changes its events except the seed,
+// which is checked on its own (--threads, the output files and the shard index do not)
+std::string shardKey(const Options& options) {
+    return "seq=" + options.seq + "\nstop=" + options.stop + "\nmode=" + options.mode + "\ntable=" + options.table +
+           "\nnum1=" + options.num1 + "\nnum2=" + options.num2 + "\ntemp=" + options.temp + "\nnn-params=" + options.nnParams +
+           "\nbatch=" + options.batch + "\nrng=" + options.rng + "\nnucleation=" + options.nucleation + "\nkform=" + options.kform + "\n";
+}
+
+// kDNA merge [--summary FILE] SHARD...: the --summary report of the whole run from the partial
+// summaries of its --shard runs, to stdout by default
+int runMerge(int argc, char* argv[]) {
+    std::string out;
+    std::vector<std::string> shards;
+    for (int i = 2; i < argc; i++) {
+        if (std::string(argv[i]) == "--summary" && i + 1 < argc) out = argv[++i];
+        else shards.push_back(argv[i]);
+    }
+    try {
+        OutputFile file(out == "-" ? "" : out, false);
+        mergeShards(shards, file.get());
+    } catch (const std::runtime_error& e) {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+// --replay FILE --event k: the path of event k of a trace file, read from its moves or
+// simulated again from its block with the options of the trace
+int runReplay(const Options& options) {
+    TraceReader reader(options.replay);
+    std::uint64_t k = std::stoull(options.event);
+    if (reader.moves()) {
+        writeTrajectory(stdout, reader.record(k), "");
+        fflush(stdout);
+        return 0;
+    }
+    EventPosition position;
+    int g;
+    double t;
+    reader.position(k, position.block, position.index, g, t);
+
+    Options run;
+    run.mode = reader.get("mode");
+    run.seq = reader.get("seq");
+    run.stop = std::to_string(position.index + 1);
+    run.kform = reader.get("kform");
+    run.num1 = reader.get("num1");
+    run.num2 = reader.get("num2");
+    run.seed = reader.get("seed");
+    run.rng = reader.get("rng");
+    run.nucleation = reader.get("nucleation");
+    run.nnParams = reader.get("nn-params");
+    std::uint64_t streamBase = std::stoull(reader.get("stream-base"));
+    double time = std::stod(reader.get("time"));
+    std::string energy = reader.get("energy");
+    RunOutput output;
+    output.energy = energy;
+    output.replay = &position;
+
+    printf("# replay event %llu of %s: block %li event %li registry %i time %.12f\n", (unsigned long long)k, options.replay.c_str(),
+           position.block, position.index, g, t);
+    if (energy.compare(0, 3, "nn ") == 0) {
+        NearestNeighborParams params = run.nnParams.empty() ? fitNearestNeighborParams() : readNearestNeighborParams(run.nnParams);
+        EnergyTable table = buildEnergyTable(params, std::stod(energy.substr(3)));
+        return runEnergyModel(run, EnergyNearestNeighbor{&table}, time, output, streamBase);
+    }
+    if (energy == "37C") return runEnergyModel(run, Energy37C{}, time, output, streamBase);
+    if (energy == "55C") return runEnergyModel(run, Energy55C{}, time, output, streamBase);
+    throw std::runtime_error("unknown energy " + energy + " in " + options.replay);
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc > 1 && std::string(argv[1]) == "merge") return runMerge(argc, argv);
+
+    Options options = parseParams(argc, argv);
+
+    if (!options.replay.empty()) {
+        try {
+            return runReplay(options);
+        } catch (const std::exception& e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+    }
+
+    // the solver methods (exact, distribution, committor) draw nothing, so they need no --stop or seed
+    bool solver = options.method == "exact" || options.method == "distribution" || options.method == "committor";
+    if ((options.seq.empty() && options.seqFile.empty() && options.sweep.empty()) || (options.stop.empty() && !solver)) {
+        printf("Error: check input parameters!!!\n");
+        return 1;
+    }
+
+    // --checkpoint FILE saves the position of the run every --checkpoint-every seconds and
+    // --resume FILE continues from it, or starts a checkpointed run when there is no FILE yet
+    std::unique_ptr<Checkpoint> checkpoint;
+    std::string checkpointFile = options.resume.empty() ? options.checkpoint : options.resume;
+    if (!checkpointFile.empty()) {
+        if (!options.seqFile.empty() || !options.sweep.empty() || options.method != "gillespie") {
+            printf("Error: --checkpoint and --resume need --method gillespie without --seq-file or --sweep\n");
+            return 1;
+        }
+        if ((options.summary.empty() && options.out.empty()) || options.summary == "-") {
+            printf("Error: --checkpoint and --resume need the events in --out or the report in a --summary file\n");
+            return 1;
+        }
+        try {
+            checkpoint = std::make_unique<Checkpoint>(checkpointFile, checkpointKey(options), std::stod(options.checkpointEvery));
+            if (!options.resume.empty() && !checkpoint->load(options.seed)) fprintf(stderr, "no checkpoint %s, starting\n", checkpointFile.c_str());
+        } catch (const std::runtime_error& e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+    }
+
+    // the same seed reproduces a run for any --threads, a clock-derived seed is reported on stderr
+    bool seedDrawn = options.seed.empty() && !solver;
+    if (seedDrawn) {
+        options.seed = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        fprintf(stderr, "seed %s\n", options.seed.c_str());
+    }
+    if (checkpoint) checkpoint->setSeed(options.seed);
+
+    // --out FILE (stdout by default), --format text (the original lines) or binary (output.hpp)
+    if (options.format != "text" && options.format != "binary") {
+        printf("Error: unknown --format %s (text or binary)\n", options.format.c_str());
+        return 1;
+    }
+    if (!options.seqFile.empty() && options.format == "binary") {
+        printf("Error: --seq-file writes text records tagged with the sequence ID, without --format binary\n");
+        return 1;
+    }
+
+    // --method gillespie (default) samples events, exact solves for the mean times,
+    // distribution for the distribution of times, committor for the zipping probability of every
+    // state, sites samples the zipping of every nucleation site and ffs samples zipping by forward flux
+    if (options.method != "gillespie" && options.method != "exact" && options.method != "distribution" && options.method != "committor" &&
+        options.method != "sites" && options.method != "ffs") {
+        printf("Error: unknown --method %s (gillespie, exact, distribution, committor, sites or ffs)\n", options.method.c_str());
+        return 1;
+    }
+    if (options.method != "gillespie" && (options.format == "binary" || !options.summary.empty())) {
+        printf("Error: --method %s writes a text report, without --format binary or --summary\n", options.method.c_str());
+        return 1;
+    }
+    if (options.method == "distribution" && options.times.empty()) {
+        printf("Error: --method distribution needs --times\n");
+        return 1;
+    }
+
+    // every method checks the window of each sequence; a single --seq is checked before any output
+    if (options.seqFile.empty() && options.sweep.empty()) {
+        try {
+            nucleationWindow(options, int(options.seq.size()));
+        } catch (const std::runtime_error& e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+    }
+
+    // --interfaces of --method ffs: 1 to kMaxFfsInterfaces (ffs.hpp)
+    if (options.method == "ffs") {
+        int interfaces = 0;
+        try {
+            interfaces = std::stoi(options.interfaces);
+        } catch (const std::logic_error&) {
+        }
+        if (interfaces < 1 || interfaces > kMaxFfsInterfaces) {
+            printf("Error: --interfaces must be 1 to %i\n", kMaxFfsInterfaces);
+            return 1;
+        }
+    }
+
+    // --precision 0.01 ends a run once the 95% confidence interval of the mean time is within
+    // 1% (of every registry with --precision-by registry), --stop bounding the number of events
+    if (options.precisionBy != "all" && options.precisionBy != "registry") {
+        printf("Error: unknown --precision-by %s (all or registry)\n", options.precisionBy.c_str());
+        return 1;
+    }
+    if (!options.precision.empty() && options.method != "gillespie") {
+        printf("Error: --precision needs --method gillespie\n");
+        return 1;
+    }
+
+    // --nucleation uniform (default) gives every contact the rate kForm, stability weights it by
+    // the stability of its stack; the exact methods assume uniform nucleation
+    if (options.nucleation != "uniform" && options.nucleation != "stability") {
+        printf("Error: unknown --nucleation %s (uniform or stability)\n", options.nucleation.c_str());
+        return 1;
+    }
+    if (options.nucleation != "uniform" && (options.method == "exact" || options.method == "distribution")) {
+        printf("Error: --nucleation %s needs --method gillespie, committor, sites or ffs\n", options.nucleation.c_str());
+        return 1;
+    }
+
+    // --kform sets the zipping rate (10^9 /s by default); --sweep grid runs every combination of
+    // the --temp or --table, --kform and --mode lists for every sequence, --sweep FILE the
+    // parameter sets of FILE, into one result table
+    if (options.sweep.empty()) {
+        std::size_t end = 0;
+        double kForm = 0.0;
+        try {
+            kForm = std::stod(options.kform, &end);
+        } catch (const std::exception&) {
+        }
+        if (!(kForm > 0.0) || end != options.kform.size()) {
+            printf("Error: --kform must be one positive rate (lists need --sweep)\n");
+            return 1;
+        }
+    } else if (options.method != "gillespie" || options.format != "text" || !options.summary.empty()) {
+        printf("Error: --sweep writes a text table of --method gillespie runs, without --format binary or --summary\n");
+        return 1;
+    }
+
+    // --trace FILE records every event of a --method gillespie run for --replay
+    if (!options.trace.empty()) {
+        if (options.traceLevel != "moves" && options.traceLevel != "positions") {
+            printf("Error: unknown --trace-level %s (moves or positions)\n", options.traceLevel.c_str());
+            return 1;
+        }
+        if (options.method != "gillespie" || !options.batch.empty() || checkpoint || !options.seqFile.empty() || !options.sweep.empty()) {
+            printf("Error: --trace needs --method gillespie without --batch, --checkpoint, --seq-file or --sweep\n");
+            return 1;
+        }
+    }
+
+    // --shard i/N runs shard i of N of a --summary run with a given --seed into a partial
+    // summary FILE; kDNA merge turns the N files into the report of the whole run
+    ShardHeader shard;
+    if (!options.shard.empty()) {
+        try {
+            shard = parseShard(options.shard);
+        } catch (const std::runtime_error& e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+        if (options.method != "gillespie" || options.summary.empty() || options.summary == "-" || seedDrawn) {
+            printf("Error: --shard needs --method gillespie, a --summary file and a --seed\n");
+            return 1;
+        }
+        if (!options.precision.empty() || checkpoint || !options.seqFile.empty() || !options.sweep.empty() || !options.trace.empty()) {
+            printf("Error: --shard runs without --precision, --checkpoint, --seq-file, --sweep or --trace\n");
+            return 1;
+        }
+        shard.key = shardKey(options);
+        shard.seed = options.seed;
+    }
+
+    try {
+        // dH/dS energy tables of --temp, built once per temperature for all sequences
+        std::unique_ptr<EnergyTableCache> cache;
+        if (!options.temp.empty() || !options.sweep.empty()) {
+            NearestNeighborParams params = options.nnParams.empty() ? fitNearestNeighborParams() : readNearestNeighborParams(options.nnParams);
+            cache = std::make_unique<EnergyTableCache>(params, options.nnParams.empty());
+        }
+
+        // --summary FILE ("-" for stdout) reports statistics instead of printing every event
+        std::unique_ptr<OutputFile> summaryFile;
+        // a resumed command keeps what its files held at the checkpoint
+        bool resumed = checkpoint && checkpoint->loaded();
+        if (!options.summary.empty()) {
+            summaryFile = std::make_unique<OutputFile>(options.summary == "-" ? "" : options.summary, !options.shard.empty(),
+                                                       resumed ? (long long)checkpoint->summaryBytes() : -1);
+            if (!options.shard.empty()) writeShardHeader(summaryFile->get(), shard);
+        }
+        FILE* summary = summaryFile ? summaryFile->get() : nullptr;
+
+        // binary output of several temperatures opens its own files
+        bool binary = options.format == "binary";
+        bool perTemperatureFiles = binary && cache && parseValues(options.temp, false).size() > 1;
+        std::unique_ptr<OutputFile> file;
+        if ((options.summary.empty() || !options.out.empty()) && !perTemperatureFiles) {
+            file = std::make_unique<OutputFile>(options.out, binary, resumed ? (long long)checkpoint->eventBytes() : -1);
+        }
+        FILE* events = file ? file->get() : nullptr;
+
+        if (!options.sweep.empty()) return runSweep(options, *cache, events);
+        if (!options.seqFile.empty()) return runSequenceFile(options, cache.get(), events, summary);
+        return runSequence(options, cache.get(), events, summary, "", checkpoint.get());
+    } catch (const std::runtime_error& e) {
+        printf("Error: %s\n", e.what());
+        return 1;
+    }
+}
+
+Options parseParams(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string temp(argv[i]);
+        if (temp == "--seq") options.seq = std::string (argv[i + 1]);
+        if (temp == "--stop") options.stop = std::string (argv[i + 1]);
+        if (temp == "--mode") options.mode = std::string (argv[i + 1]);
+        if (temp == "--table") options.table = std::string (argv[i + 1]);
+        if (temp == "--num1") options.num1 = std::string (argv[i + 1]);
+        if (temp == "--num2") options.num2 = std::string (argv[i + 1]);
+        if (temp == "--temp") options.temp = std::string (argv[i + 1]);
+        if (temp == "--nn-params") options.nnParams = std::string (argv[i + 1]);
+        if (temp == "--seed") options.seed = std::string (argv[i + 1]);
+        if (temp == "--threads") options.threads = std::string (argv[i + 1]);
+        if (temp == "--batch") options.batch = std::string (argv[i + 1]);
+        if (temp == "--rng") options.rng = std::string (argv[i + 1]);
+        if (temp == "--out") options.out = std::string (argv[i + 1]);
+        if (temp == "--format") options.format = std::string (argv[i + 1]);
+        if (temp == "--summary") options.summary = std::string (argv[i + 1]);
+        if (temp == "--method") options.method = std::string (argv[i + 1]);
+        if (temp == "--times") options.times = std::string (argv[i + 1]);
+        if (temp == "--seq-file") options.seqFile = std::string (argv[i + 1]);
+        if (temp == "--checkpoint") options.checkpoint = std::string (argv[i + 1]);
+        if (temp == "--checkpoint-every") options.checkpointEvery = std::string (argv[i + 1]);
+        if (temp == "--resume") options.resume = std::string (argv[i + 1]);
+        if (temp == "--precision") options.precision = std::string (argv[i + 1]);
+        if (temp == "--precision-by") options.precisionBy = std::string (argv[i + 1]);
+        if (temp == "--nucleation") options.nucleation = std::string (argv[i + 1]);
+        if (temp == "--kform") options.kform = std::string (argv[i + 1]);
+        if (temp == "--sweep") options.sweep = std::string (argv[i + 1]);
+        if (temp == "--trace") options.trace = std::string (argv[i + 1]);
+        if (temp == "--trace-level") options.traceLevel = std::string (argv[i + 1]);
+        if (temp == "--replay") options.replay = std::string (argv[i + 1]);
+        if (temp == "--event") options.event = std::string (argv[i + 1]);
+        if (temp == "--interfaces") options.interfaces = std::string (argv[i + 1]);
+        if (temp == "--shard") options.shard = std::string (argv[i + 1]);
+    }
+    return options;
+}
@@ -0,0 +1,237 @@
+//LOCKSTEP SIMULATION OF MANY TRAJECTORIES IN A STRUCTURE-OF-ARRAYS BATCH
+
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KDNA_X86 1
+#endif
+
+#include "engine.hpp"
+#include "rng.hpp"
+
+// Trajectory state of a batch, one array entry per lane (64-bit so the lanes line up with
+// the double-precision rate vectors)
+template <int Lanes>
+struct BatchState {
+    alignas(64) std::int64_t xL[Lanes], xR[Lanes], yL[Lanes], yR[Lanes], hBonds[Lanes], g[Lanes];
+    alignas(64) std::int64_t active[Lanes];  // -1 when the lane takes a Gillespie step this iteration
+    alignas(64) double t[Lanes];
+};
+
+// One Gillespie step of every active lane; u and e hold a uniform and a unit exponential per lane
+template <int Lanes>
+void batchStepScalar(BatchState<Lanes>& s, const RateTable& rates, const double* u, const double* e) {
+    for (int l = 0; l < Lanes; l++) {
+        if (!s.active[l]) continue;
+        int row = rates.row(int(s.yL[l]), int(s.xL[l]));
+        double kB1 = rates.kBreak(int(s.xL[l]), int(s.yL[l]));
+        double kB2 = (s.xR[l] == s.xL[l]) ? 0.0 : rates.kBreak(int(s.xR[l]), int(s.yR[l]));
+        double kFL = (s.xL[l] == rates.lMinRow[row]) ? 0.0 : rates.kForm;
+        double kFR = (s.xR[l] == rates.rMaxRow[row]) ? 0.0 : rates.kForm;
+        double kTotal = kB1 + kB2 + kFL + kFR;
+        double r = u[l]*kTotal;
+        if (r <= kB1) {
+            s.xL[l]++; s.yL[l]++; s.hBonds[l]--;
+        } else if (r <= kB1 + kB2) {
+            s.xR[l]--; s.yR[l]--; s.hBonds[l]--;
+        } else if (r <= kB1 + kB2 + kFL) {
+            s.xL[l]--; s.yL[l]--; s.hBonds[l]++;
+        } else {
+            s.xR[l]++; s.yR[l]++; s.hBonds[l]++;
+        }
+        if (s.hBonds[l] == 0) s.xL[l] = s.xR[l] = s.yL[l] = s.yR[l] = 0;
+        s.t[l] += e[l]/kTotal;
+    }
+}
+
+#ifdef KDNA_X86
+// Stack indices step1[x]*kStackCodes + step2[y] of four lanes, by 4-byte gathers of the 1-byte
+// indices (the step vectors are padded past the last position)
+__attribute__((target("avx2"))) inline __m256i gatherStacks(const RateTable& rates, __m256i x, __m256i y) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const int* step1 = reinterpret_cast<const int*>(rates.step1.data());
+    const int* step2 = reinterpret_cast<const int*>(rates.step2.data());
+    __m256i s1 = _mm256_cvtepi32_epi64(_mm_and_si128(_mm256_i64gather_epi32(step1, x, 1), byteMask));
+    __m256i s2 = _mm256_cvtepi32_epi64(_mm_and_si128(_mm256_i64gather_epi32(step2, y, 1), byteMask));
+    return _mm256_add_epi64(_mm256_mul_epi32(s1, _mm256_set1_epi64x(kStackCodes)), s2);
+}
+
+// Same step four lanes at a time: the neighbor-pair indices and rates come from AVX2 gathers
+// and the move is selected with compare masks instead of branches
+template <int Lanes>
+__attribute__((target("avx2"))) void batchStepAvx2(BatchState<Lanes>& s, const RateTable& rates, const double* u, const double* e) {
+    static_assert(Lanes % 4 == 0, "AVX2 batches need a multiple of 4 lanes");
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i len = _mm256_set1_epi64x(rates.len);
+    const __m256d kForm = _mm256_set1_pd(rates.kForm);
+    const double* stackRates = rates.stackRates.data();
+
+    for (int l = 0; l < Lanes; l += 4) {
+        __m256i xL = _mm256_load_si256((const __m256i*)(s.xL + l));
+        __m256i xR = _mm256_load_si256((const __m256i*)(s.xR + l));
+        __m256i yL = _mm256_load_si256((const __m256i*)(s.yL + l));
+        __m256i yR = _mm256_load_si256((const __m256i*)(s.yR + l));
+        __m256i h = _mm256_load_si256((const __m256i*)(s.hBonds + l));
+        __m256i active = _mm256_load_si256((const __m256i*)(s.active + l));
+        // idle lanes read position 1, which always exists
+        __m256i xLSafe = _mm256_blendv_epi8(one, xL, active);
+        __m256i xRSafe = _mm256_blendv_epi8(one, xR, active);
+        __m256i yLSafe = _mm256_blendv_epi8(one, yL, active);
+        __m256i yRSafe = _mm256_blendv_epi8(one, yR, active);
+
+        __m256d kB1 = _mm256_i64gather_pd(stackRates, gatherStacks(rates, xLSafe, yLSafe), 8);
+        __m256i single = _mm256_cmpeq_epi64(xL, xR);
+        __m256d kB2 = _mm256_mask_i64gather_pd(_mm256_setzero_pd(), stackRates, gatherStacks(rates, xRSafe, yRSafe),
+                                               _mm256_castsi256_pd(_mm256_andnot_si256(single, _mm256_set1_epi64x(-1))), 8);
+        // getParams bounds of registry g = yL - xL: rMax = len - max(g, 0), lMin = 1 + max(-g, 0)
+        __m256i g = _mm256_sub_epi64(yL, xL);
+        __m256i positive = _mm256_cmpgt_epi64(g, zero);
+        __m256i rMax = _mm256_sub_epi64(len, _mm256_and_si256(positive, g));
+        __m256i lMin = _mm256_sub_epi64(one, _mm256_andnot_si256(positive, g));
+        __m256d kFL = _mm256_andnot_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(xL, lMin)), kForm);
+        __m256d kFR = _mm256_andnot_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(xR, rMax)), kForm);
+
+        __m256d k1 = kB1;
+        __m256d k12 = _mm256_add_pd(k1, kB2);
+        __m256d k123 = _mm256_add_pd(k12, kFL);
+        __m256d kTotal = _mm256_add_pd(k123, kFR);
+        __m256d r = _mm256_mul_pd(_mm256_loadu_pd(u + l), kTotal);
+        __m256i c1 = _mm256_castpd_si256(_mm256_cmp_pd(r, k1, _CMP_LE_OQ));
+        __m256i c12 = _mm256_castpd_si256(_mm256_cmp_pd(r, k12, _CMP_LE_OQ));
+        __m256i c123 = _mm256_castpd_si256(_mm256_cmp_pd(r, k123, _CMP_LE_OQ));
+        // masks are -1 when set: fray left xL+1, fray right xR-1, zip left xL-1, zip right xR+1
+        __m256i frayRight = _mm256_andnot_si256(c1, c12);
+        __m256i zipLeft = _mm256_andnot_si256(c12, c123);
+        __m256i zipRight = _mm256_andnot_si256(c123, _mm256_set1_epi64x(-1));
+        __m256i dxL = _mm256_and_si256(active, _mm256_sub_epi64(zipLeft, c1));
+        __m256i dxR = _mm256_and_si256(active, _mm256_sub_epi64(frayRight, zipRight));
+        __m256i dh = _mm256_and_si256(active, _mm256_add_epi64(one, _mm256_add_epi64(c12, c12)));
+
+        xL = _mm256_add_epi64(xL, dxL); yL = _mm256_add_epi64(yL, dxL);
+        xR = _mm256_add_epi64(xR, dxR); yR = _mm256_add_epi64(yR, dxR);
+        h = _mm256_add_epi64(h, dh);
+        __m256i melted = _mm256_and_si256(active, _mm256_cmpeq_epi64(h, zero));
+        _mm256_store_si256((__m256i*)(s.xL + l), _mm256_andnot_si256(melted, xL));
+        _mm256_store_si256((__m256i*)(s.xR + l), _mm256_andnot_si256(melted, xR));
+        _mm256_store_si256((__m256i*)(s.yL + l), _mm256_andnot_si256(melted, yL));
+        _mm256_store_si256((__m256i*)(s.yR + l), _mm256_andnot_si256(melted, yR));
+        _mm256_store_si256((__m256i*)(s.hBonds + l), h);
+
+        __m256d tau = _mm256_and_pd(_mm256_castsi256_pd(active), _mm256_div_pd(_mm256_loadu_pd(e + l), kTotal));
+        _mm256_store_pd(s.t + l, _mm256_add_pd(_mm256_load_pd(s.t + l), tau));
+    }
+}
+#endif
+
+// Lanes independent trajectories advanced one event per iteration in lockstep. Each lane has
+// its own RNG substream; lanes that melt, zip or need a nucleus are handled per lane between
+// vector steps, so the batch follows the same model as Simulation, event for event per lane.
+template <class EnergyModel, class Nucleation, class Absorption, int Lanes = 8>
+class BatchSimulation {
+public:
+    static constexpr long blockEvents = Lanes*kBlockEvents;
+
+    BatchSimulation(const RateTable& rates, Nucleation nucleation, double time)
+        : rates(rates), nucleation(nucleation), time(time) {}
+
+    // Batches are not traced (trajectory.hpp)
+    void startBlock(long) {}
+
+    // Same contract as Simulation::run; lane l draws from mt.substream(l) and records a fixed
+    // share of the events (a lane that stopped at whichever event came first would favor short
+    // events), recorded in lane order within an iteration
+    template <class Rng, class Record>
+    long run(long stopCondition, Rng& mt, Record&& record) {
+        BatchState<Lanes> s{};
+        std::vector<Rng> laneRng;
+        long quota[Lanes];
+        for (int l = 0; l < Lanes; l++) {
+            laneRng.push_back(mt.substream(l));
+            quota[l] = stopCondition/Lanes + (l < stopCondition % Lanes ? 1 : 0);
+        }
+        const double kNucleation = nucleation.rate(rates);
+#ifdef KDNA_X86
+        const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+        // uniforms and unit exponentials, refilled per lane every kBuffer iterations
+        constexpr int kBuffer = 64;
+        std::vector<double> uBuf(kBuffer*Lanes), eBuf(kBuffer*Lanes);
+        int next = kBuffer;
+        long success = 0;
+        const long firstSteps = steps;
+
+        while (true) {
+            if (next == kBuffer) {
+                double lane[2][kBuffer];
+                for (int l = 0; l < Lanes; l++) {
+                    fillUniform(laneRng[l], lane[0], kBuffer);
+                    fillExponential(laneRng[l], lane[1], kBuffer);
+                    for (int k = 0; k < kBuffer; k++) {
+                        uBuf[k*Lanes + l] = lane[0][k];
+                        eBuf[k*Lanes + l] = lane[1][k];
+                    }
+                }
+                next = 0;
+            }
+            if (success == stopCondition) return success;
+            for (int l = 0; l < Lanes; l++) {
+                s.active[l] = -1;
+                if (quota[l] == 0) {
+                    s.active[l] = 0;
+                } else if (s.xL[l] == 0 && s.xR[l] == 0) {
+                    auto [x, y] = nucleation(laneRng[l]);
+                    s.g[l] = y - x;
+                    s.xL[l] = s.xR[l] = x;
+                    s.yL[l] = s.yR[l] = y;
+                    s.hBonds[l] = 1;
+                    s.t[l] += exponential(laneRng[l], exponentialZiggurat())/kNucleation;
+                    s.active[l] = 0;
+                    steps++;
+                }
+            }
+            const double* u = &uBuf[next*Lanes];
+            const double* e = &eBuf[next*Lanes];
+            next++;
+#ifdef KDNA_X86
+            if (avx2) batchStepAvx2(s, rates, u, e);
+            else batchStepScalar(s, rates, u, e);
+#else
+            batchStepScalar(s, rates, u, e);
+#endif
+            bool capped = false;
+            for (int l = 0; l < Lanes; l++) {
+                if (!s.active[l]) continue;
+                steps++;
+                int full = rates.len - int(std::abs(s.g[l]));
+                if (s.hBonds[l] == 0 || s.hBonds[l] == full) {
+                    State lane = {int(s.xL[l]), int(s.xR[l]), int(s.yL[l]), int(s.yR[l]), int(s.g[l]), int(s.hBonds[l]), s.t[l], full};
+                    if (Absorption::absorb(lane, record)) {
+                        success++;
+                        quota[l]--;
+                    }
+                    s.xL[l] = lane.xL; s.xR[l] = lane.xR;
+                    s.yL[l] = lane.yL; s.yR[l] = lane.yR;
+                    s.g[l] = lane.g; s.t[l] = lane.t;
+                }
+                if (s.t[l] >= time) capped = true;
+            }
+            if (capped || steps - firstSteps >= maxSteps) return success;
+        }
+    }
+
+    long steps = 0;  // events of all lanes and runs, nucleations included
+    long maxSteps = std::numeric_limits<long>::max();  // step budget of a run, to within a batch step (kBench)
+
+private:
+    const RateTable& rates;
+    Nucleation nucleation;
+    double time;
+};
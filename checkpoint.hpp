@@ -0,0 +1,239 @@
+//CHECKPOINT AND RESTART OF LONG RUNS
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+#include "output.hpp"
+#include "stats.hpp"
+
+// Checkpoint files: a header, then the fields of CheckpointState in the order below
+//
+//   char[8]  magic "KDNACKP\0"
+//   uint32   version (2)
+//   uint32   payload bytes
+constexpr char kCheckpointMagic[8] = {'K', 'D', 'N', 'A', 'C', 'K', 'P', '\0'};
+constexpr std::uint32_t kCheckpointVersion = 2;
+
+// Fixed-width fields appended to a byte string
+class ByteWriter {
+public:
+    template <class T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "fields are copied byte for byte");
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const std::string& text) {
+        put(std::uint64_t(text.size()));
+        bytes += text;
+    }
+
+    std::string bytes;
+};
+
+// Reads the fields of a ByteWriter back, throwing on a truncated or corrupt payload
+class ByteReader {
+public:
+    explicit ByteReader(const std::string& bytes) : data(bytes.data()), left(bytes.size()) {}
+
+    template <class T>
+    void get(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "fields are copied byte for byte");
+        if (left < sizeof(T)) throw std::runtime_error("corrupt checkpoint");
+        std::memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        left -= sizeof(T);
+    }
+
+    void getString(std::string& text) {
+        std::uint64_t size = 0;
+        get(size);
+        text.assign(data, count(size, 1));
+        data += size;
+        left -= size;
+    }
+
+    // n elements of elementBytes bytes, when they fit in what is left
+    std::size_t count(std::uint64_t n, std::size_t elementBytes) const {
+        if (n > left/elementBytes) throw std::runtime_error("corrupt checkpoint");
+        return n;
+    }
+
+private:
+    const char* data;
+    std::size_t left;
+};
+
+// Where a command stands: the runs (temperatures) of a command are numbered from 0, runs
+// before run are complete, run continues at block with the events and summary report written
+// so far taking eventBytes and summaryBytes of their files
+struct CheckpointState {
+    std::string key;  // options the output depends on
+    std::string seed;
+    std::uint64_t run = 0;
+    std::uint64_t block = 0;
+    std::uint64_t eventBytes = 0;
+    std::uint64_t summaryBytes = 0;
+    std::string summary;  // SummaryCollector of run, empty at block 0 or without --summary
+    std::string precision;  // PrecisionRule of run, empty at block 0 or without --precision
+};
+
+// Periodic checkpoints of a command. Block b of a run always draws from the stream
+// (seed, streamBase + b) and starts from fresh trajectories (runner.hpp), so the position in the
+// block sequence, the summary statistics and the output sizes are all the state there is: a
+// resumed command truncates its files to the checkpointed sizes and writes exactly what the
+// uninterrupted command would have written.
+class Checkpoint {
+public:
+    Checkpoint(std::string fileName, std::string key, double interval)
+        : fileName(std::move(fileName)), interval(interval), last(std::chrono::steady_clock::now()) {
+        state.key = std::move(key);
+    }
+
+    // Continue from the checkpoint file, taking its seed when seed is empty; false when there is
+    // no checkpoint yet
+    bool load(std::string& seed) {
+        FILE* file = fopen(fileName.c_str(), "rb");
+        if (!file) return false;
+        char magic[8];
+        std::uint32_t header[2];
+        std::string payload;
+        bool ok = fread(magic, 1, 8, file) == 8 && std::memcmp(magic, kCheckpointMagic, 8) == 0 &&
+                  fread(header, sizeof(header), 1, file) == 1 && header[0] == kCheckpointVersion;
+        if (ok) {
+            payload.resize(header[1]);
+            ok = fread(&payload[0], 1, payload.size(), file) == payload.size();
+        }
+        fclose(file);
+        if (!ok) throw std::runtime_error("corrupt checkpoint " + fileName);
+
+        CheckpointState saved;
+        ByteReader in(payload);
+        in.getString(saved.key);
+        in.getString(saved.seed);
+        in.get(saved.run);
+        in.get(saved.block);
+        in.get(saved.eventBytes);
+        in.get(saved.summaryBytes);
+        in.getString(saved.summary);
+        in.getString(saved.precision);
+        if (saved.key != state.key) throw std::runtime_error("checkpoint " + fileName + " was written with other options");
+        if (!seed.empty() && saved.seed != seed) throw std::runtime_error("checkpoint " + fileName + " has seed " + saved.seed);
+        seed = saved.seed;
+        state = saved;
+        resumed = true;
+        return true;
+    }
+
+    // Seed of the command, saved for a resume without --seed
+    void setSeed(const std::string& seed) { state.seed = seed; }
+
+    bool loaded() const { return resumed; }
+    std::uint64_t eventBytes() const { return state.eventBytes; }
+    std::uint64_t summaryBytes() const { return state.summaryBytes; }
+
+    // Run run was completed before the restart
+    bool done(std::uint64_t run) const { return resumed && run < state.run; }
+
+    // Run run continues a partial run, whose event file is kept up to eventBytes()
+    bool continues(std::uint64_t run) const { return resumed && run == state.run && state.block > 0; }
+
+    // Run run starts writing to eventFile (its own file unless sharedEventFile) and summaryFile,
+    // either of which may be null
+    void startRun(std::uint64_t run, FILE* eventFile, bool sharedEventFile, FILE* summaryFile) {
+        current = run;
+        this->eventFile = eventFile;
+        this->sharedEventFile = sharedEventFile;
+        this->summaryFile = summaryFile;
+    }
+
+    // First block of the current run
+    std::uint64_t firstBlock() const { return continues(current) ? state.block : 0; }
+
+    void restoreSummary(SummaryCollector& summary) const {
+        if (!continues(current) || state.summary.empty()) return;
+        ByteReader in(state.summary);
+        summary.load(in);
+    }
+
+    void restorePrecision(PrecisionRule& precision) const {
+        if (!continues(current) || state.precision.empty()) return;
+        ByteReader in(state.precision);
+        precision.load(in);
+    }
+
+    // After every emitted block of the current run, nextBlock being the first block not
+    // emitted; saves when the interval has elapsed since the last checkpoint
+    void blockDone(std::uint64_t nextBlock, OutputWriter* events, const SummaryCollector* summary, const PrecisionRule* precision) {
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - last).count() < interval) return;
+        if (events) events->flush();
+        // called from the worker threads of the runner: a failed save is retried next interval
+        try {
+            save(current, nextBlock, eventFile ? ftello(eventFile) : 0, summary, precision);
+        } catch (const std::runtime_error& e) {
+            fprintf(stderr, "Error: %s\n", e.what());
+        }
+        last = now;
+    }
+
+    // After the current run, its summary report written
+    void runDone() {
+        if (eventFile) fflush(eventFile);
+        save(current + 1, 0, (eventFile && sharedEventFile) ? ftello(eventFile) : 0, nullptr, nullptr);
+        last = std::chrono::steady_clock::now();
+    }
+
+private:
+    // Written to fileName.tmp and renamed over the checkpoint, after the output files reached
+    // the disk, so a checkpoint never points past the data it describes
+    void save(std::uint64_t run, std::uint64_t block, std::uint64_t eventBytes, const SummaryCollector* summary,
+              const PrecisionRule* precision) {
+        if (eventFile) fsync(fileno(eventFile));
+        if (summaryFile) {
+            fflush(summaryFile);
+            fsync(fileno(summaryFile));
+        }
+        ByteWriter out;
+        out.putString(state.key);
+        out.putString(state.seed);
+        out.put(run);
+        out.put(block);
+        out.put(eventBytes);
+        out.put(std::uint64_t(summaryFile ? ftello(summaryFile) : 0));
+        ByteWriter summaryBytes;
+        if (summary && block > 0) summary->save(summaryBytes);
+        out.putString(summaryBytes.bytes);
+        ByteWriter precisionBytes;
+        if (precision && block > 0) precision->save(precisionBytes);
+        out.putString(precisionBytes.bytes);
+
+        std::string temp = fileName + ".tmp";
+        FILE* file = fopen(temp.c_str(), "wb");
+        if (!file) throw std::runtime_error("cannot open " + temp);
+        std::uint32_t header[2] = {kCheckpointVersion, std::uint32_t(out.bytes.size())};
+        bool ok = fwrite(kCheckpointMagic, 1, 8, file) == 8 && fwrite(header, sizeof(header), 1, file) == 1 &&
+                  fwrite(out.bytes.data(), 1, out.bytes.size(), file) == out.bytes.size() && fflush(file) == 0 &&
+                  fsync(fileno(file)) == 0;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(temp.c_str(), fileName.c_str()) != 0) throw std::runtime_error("cannot write checkpoint " + fileName);
+    }
+
+    std::string fileName;
+    double interval;
+    std::chrono::steady_clock::time_point last;
+    CheckpointState state;
+    bool resumed = false;
+    std::uint64_t current = 0;
+    FILE* eventFile = nullptr;
+    bool sharedEventFile = true;
+    FILE* summaryFile = nullptr;
+};
@@ -0,0 +1,348 @@
+//NEAREST-NEIGHBOR FREE ENERGIES OF THE HYBRIDIZATION MODEL
+
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+// Base codes of the encoded strands s1/s2: 0 = no base (past the end of a strand),
+// 1-4 = A/T/C/G, 11-44 = a/t/c/g of a stem-loop region (repulsive stacking)
+// Reference cascades: dG of the stack 5'-k kn-3' / 3'-j jn-5' in units of kT, 0 for pairs not listed
+
+constexpr double getEnergyReference37C(int j, int k, int jn, int kn) {
+    double en = 0;
+    // Nearest-neighbor free energies of SantaLucia et al. at 37C - 0.5M NaCl - unit of kT
+    if ((k == 1 && kn == 1 && j == 2 && jn == 2) || (k == 2 && kn == 2 && j == 1 && jn == 1)) en = -1.55;
+    else if (k == 1 && kn == 2 && j == 2 && jn == 1) en = -1.35;
+    else if (k == 2 && kn == 1 && j == 1 && jn == 2) en = -0.85;
+    else if ((k == 3 && kn == 1 && j == 4 && jn == 2) || (k == 2 && kn == 4 && j == 1 && jn == 3)) en = -2.31;
+    else if ((k == 4 && kn == 2 && j == 3 && jn == 1) || (k == 1 && kn == 3 && j == 2 && jn == 4)) en = -2.30;
+    else if ((k == 3 && kn == 2 && j == 4 && jn == 1) || (k == 1 && kn == 4 && j == 2 && jn == 3)) en = -2.03;
+    else if ((k == 4 && kn == 1 && j == 3 && jn == 2) || (k == 2 && kn == 3 && j == 1 && jn == 4)) en = -2.06;
+    else if (k == 3 && kn == 4 && j == 4 && jn == 3) en = -3.53;
+    else if (k == 4 && kn == 3 && j == 3 && jn == 4) en = -3.65;
+    else if ((k == 4 && kn == 4 && j == 3 && jn == 3) || (k == 3 && kn == 3 && j == 4 && jn == 4)) en = -2.97;
+
+    // Repulsive nearest-neighbor free energies for stem-loop region at 37C - 0.5M NaCl - unit of kT
+    else if ((k == 11 && kn == 11 && j == 22 && jn == 22) || (k == 22 && kn == 22 && j == 11 && jn == 11)) en = 1.55;
+    else if (k == 11 && kn == 22 && j == 22 && jn == 11) en = 1.35;
+    else if (k == 22 && kn == 11 && j == 11 && jn == 22) en = 0.85;
+    else if ((k == 33 && kn == 11 && j == 44 && jn == 22) || (k == 22 && kn == 44 && j == 11 && jn == 33)) en = 2.31;
+    else if ((k == 44 && kn == 22 && j == 33 && jn == 11) || (k == 11 && kn == 33 && j == 22 && jn == 44)) en = 2.30;
+    else if ((k == 33 && kn == 22 && j == 44 && jn == 11) || (k == 11 && kn == 44 && j == 22 && jn == 33)) en = 2.03;
+    else if ((k == 44 && kn == 11 && j == 33 && jn == 22) || (k == 22 && kn == 33 && j == 11 && jn == 44)) en = 2.06;
+    else if (k == 33 && kn == 44 && j == 44 && jn == 33) en = 3.53;
+    else if (k == 44 && kn == 33 && j == 33 && jn == 44) en = 3.65;
+    else if ((k == 44 && kn == 44 && j == 33 && jn == 33) || (k == 33 && kn == 33 && j == 44 && jn == 44)) en = 2.97;
+
+    // Santa 1:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 1) || (k == 1  && kn == 2  && j == 1  && jn == 1)) en = 1.16;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 1) || (k == 1  && kn == 4  && j == 1  && jn == 3)) en = 0.86;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 1) || (k == 1  && kn == 3  && j == 1  && jn == 4)) en = 0.42;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 1) || (k == 1  && kn == 1  && j == 1  && jn == 2)) en = 1.30;
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 3) || (k == 3  && kn == 2  && j == 3  && jn == 1)) en = 2.38;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 3) || (k == 3  && kn == 4  && j == 3  && jn == 3)) en = 1.31;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 3) || (k == 3  && kn == 3  && j == 3  && jn == 4)) en = 1.47;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 3) || (k == 3  && kn == 1  && j == 3  && jn == 2)) en = 1.91;
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 4) || (k == 4  && kn == 2  && j == 4  && jn == 1)) en = -0.09;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 4) || (k == 4  && kn == 4  && j == 4  && jn == 3)) en = -0.05;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 4) || (k == 4  && kn == 3  && j == 4  && jn == 4)) en = -1.74;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 4) || (k == 4  && kn == 1  && j == 4  && jn == 2)) en = 0.88;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 2) || (k == 2  && kn == 2  && j == 2  && jn == 1)) en = 1.30;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 2) || (k == 2  && kn == 4  && j == 2  && jn == 3)) en = -0.07;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 2) || (k == 2  && kn == 3  && j == 2  && jn == 4)) en = 0.89;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 2) || (k == 2  && kn == 1  && j == 2  && jn == 2)) en = 1.28;
+    // Santa 2:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 3 ) || (k == 3  && kn == 2  && j == 1  && jn == 1)) en = 1.62;
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 1 ) || (k == 1  && kn == 2  && j == 3  && jn == 1)) en = 1.43;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 3 ) || (k == 3  && kn == 4  && j == 1  && jn == 3)) en = 1.40;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 1 ) || (k == 1  && kn == 4  && j == 3  && jn == 3)) en = 1.47;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 3 ) || (k == 3  && kn == 3  && j == 1  && jn == 4)) en = 1.50;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 1 ) || (k == 1  && kn == 3  && j == 3  && jn == 4)) en = 1.10;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 3 ) || (k == 3  && kn == 1  && j == 1  && jn == 2)) en = 1.69;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 1 ) || (k == 1  && kn == 1  && j == 3  && jn == 2)) en = 2.38;
+    // Santa 3:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 4 ) || (k == 4  && kn == 2  && j == 1  && jn == 1 )) en = 0.37;
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 1 ) || (k == 1  && kn == 2  && j == 4  && jn == 1 )) en = 0.17;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 4 ) || (k == 4  && kn == 4  && j == 1  && jn == 3 )) en = 0.18;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 1 ) || (k == 1  && kn == 4  && j == 4  && jn == 3 )) en = 0.32;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 4 ) || (k == 4  && kn == 3  && j == 1  && jn == 4 )) en = -0.29;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 1 ) || (k == 1  && kn == 3  && j == 4  && jn == 4 )) en = -0.74;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 4 ) || (k == 4  && kn == 1  && j == 1  && jn == 2 )) en = 0.84;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 1 ) || (k == 1  && kn == 1  && j == 4  && jn == 2 )) en = 1.38;
+    // Santa 4:
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 2 ) || (k == 2  && kn == 2  && j == 4  && jn == 1 )) en = 1.33;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 4 ) || (k == 4  && kn == 2  && j == 2  && jn == 1 )) en = 0.25;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 2 ) || (k == 2  && kn == 4  && j == 4  && jn == 3 )) en = -0.66;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 4 ) || (k == 4  && kn == 4  && j == 2  && jn == 3 )) en = -0.41;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 2 ) || (k == 2  && kn == 3  && j == 4  && jn == 4 )) en = 0.27;
+    else if ((k == 4  && kn == 4  && j == 2  && jn == 2 ) || (k == 2  && kn == 2  && j == 4  && jn == 4 )) en = 1.38;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 4 ) || (k == 4  && kn == 3  && j == 2  && jn == 4 )) en = -0.86;
+    else if (k == 4   && kn == 2  && j == 2  && jn == 4 ) en = 2.07;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 2 ) || (k == 2  && kn == 1  && j == 4  && jn == 2)) en = 0.86;
+    else if (k == 2   && kn == 4  && j == 4  && jn == 2 ) en = 1.01;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 4 ) || (k == 4  && kn == 1  && j == 2  && jn == 2)) en = 0.71;
+    // Santa 5:
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 2) || (k == 2  && kn == 2  && j == 3  && jn == 1 )) en = 1.21;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 3) || (k == 3  && kn == 2  && j == 2  && jn == 1 )) en = 1.37;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 2) || (k == 2  && kn == 4  && j == 3  && jn == 3 )) en = 1.18;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 3) || (k == 3  && kn == 4  && j == 2  && jn == 3 )) en = 0.81;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 2) || (k == 2  && kn == 3  && j == 3  && jn == 4 )) en = 1.18;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 3) || (k == 3  && kn == 3  && j == 2  && jn == 4 )) en = 1.79;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 2) || (k == 2  && kn == 1  && j == 3  && jn == 2 )) en = 1.77;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 3) || (k == 3  && kn == 1  && j == 2  && jn == 2 )) en = 1.40;
+
+    return en;
+}
+
+constexpr double getEnergyReference55C(int j, int k, int jn, int kn) {
+    double en = 0;
+    // Nearest-neighbor free energies of SantaLucia et al. at 55C - 0.5M NaCl - unit of kT
+    if ((k == 1 && kn == 1 && j == 2 && jn == 2) || (k == 2 && kn == 2 && j == 1 && jn == 1)) en = -0.89;
+    else if (k == 1 && kn == 2 && j == 2 && jn == 1) en = -0.71;
+    else if (k == 2 && kn == 1 && j == 1 && jn == 2) en = -0.21;
+    else if ((k == 3 && kn == 1 && j == 4 && jn == 2) || (k == 2 && kn == 4 && j == 1 && jn == 3)) en = -1.63;
+    else if ((k == 4 && kn == 2 && j == 3 && jn == 1) || (k == 1 && kn == 3 && j == 2 && jn == 4)) en = -1.63;
+    else if ((k == 3 && kn == 2 && j == 4 && jn == 1) || (k == 1 && kn == 4 && j == 2 && jn == 3)) en = -1.39;
+    else if ((k == 4 && kn == 1 && j == 3 && jn == 2) || (k == 2 && kn == 3 && j == 1 && jn == 4)) en = -1.40;
+    else if (k == 3 && kn == 4 && j == 4 && jn == 3) en = -2.68;
+    else if (k == 4 && kn == 3 && j == 3 && jn == 4) en = -2.89;
+    else if ((k == 4 && kn == 4 && j == 3 && jn == 3) || (k == 3 && kn == 3 && j == 4 && jn == 4)) en = -2.34;
+
+    // Repulsive nearest-neighbor free energies for stem-loop region at 55C - 0.5M NaCl - unit of kT
+    else if ((k == 11 && kn == 11 && j == 22 && jn == 22) || (k == 22 && kn == 22 && j == 11 && jn == 11)) en = 0.89;
+    else if (k == 11 && kn == 22 && j == 22 && jn == 11) en = 0.71;
+    else if (k == 22 && kn == 11 && j == 11 && jn == 22) en = 0.21;
+    else if ((k == 33 && kn == 11 && j == 44 && jn == 22) || (k == 22 && kn == 44 && j == 11 && jn == 33)) en = 1.63;
+    else if ((k == 44 && kn == 22 && j == 33 && jn == 11) || (k == 11 && kn == 33 && j == 22 && jn == 44)) en = 1.63;
+    else if ((k == 33 && kn == 22 && j == 44 && jn == 11) || (k == 11 && kn == 44 && j == 22 && jn == 33)) en = 1.39;
+    else if ((k == 44 && kn == 11 && j == 33 && jn == 22) || (k == 22 && kn == 33 && j == 11 && jn == 44)) en = 1.40;
+    else if (k == 33 && kn == 44 && j == 44 && jn == 33) en = 2.68;
+    else if (k == 44 && kn == 33 && j == 33 && jn == 44) en = 2.89;
+    else if ((k == 44 && kn == 44 && j == 33 && jn == 33) || (k == 33 && kn == 33 && j == 44 && jn == 44)) en = 2.34;
+
+    // Santa 1:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 1) || (k == 1  && kn == 2  && j == 1  && jn == 1)) en = 1.23;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 1) || (k == 1  && kn == 4  && j == 1  && jn == 3)) en = 0.95;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 1) || (k == 1  && kn == 3  && j == 1  && jn == 4)) en = 0.67;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 1) || (k == 1  && kn == 1  && j == 1  && jn == 2)) en = 0.93;
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 3) || (k == 3  && kn == 2  && j == 3  && jn == 1)) en = 2.58;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 3) || (k == 3  && kn == 4  && j == 3  && jn == 3)) en = 1.60;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 3) || (k == 3  && kn == 3  && j == 3  && jn == 4)) en = 1.29;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 3) || (k == 3  && kn == 1  && j == 3  && jn == 2)) en = 1.35;
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 4) || (k == 4  && kn == 2  && j == 4  && jn == 1)) en = 0.17;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 4) || (k == 4  && kn == 4  && j == 4  && jn == 3)) en = 0.35;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 4) || (k == 4  && kn == 3  && j == 4  && jn == 4)) en = -1.23;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 4) || (k == 4  && kn == 1  && j == 4  && jn == 2)) en = 0.85;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 2) || (k == 2  && kn == 2  && j == 2  && jn == 1)) en = 1.57;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 2) || (k == 2  && kn == 4  && j == 2  && jn == 3)) en = 0.45;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 2) || (k == 2  && kn == 3  && j == 2  && jn == 4)) en = 1.08;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 2) || (k == 2  && kn == 1  && j == 2  && jn == 2)) en = 1.31;
+    // Santa 2:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 3 ) || (k == 3  && kn == 2  && j == 1  && jn == 1)) en = 1.48;
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 1 ) || (k == 1  && kn == 2  && j == 3  && jn == 1)) en = 1.00;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 3 ) || (k == 3  && kn == 4  && j == 1  && jn == 3)) en = 1.30;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 1 ) || (k == 1  && kn == 4  && j == 3  && jn == 3)) en = 1.49;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 3 ) || (k == 3  && kn == 3  && j == 1  && jn == 4)) en = 1.05;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 1 ) || (k == 1  && kn == 3  && j == 3  && jn == 4)) en = 1.06;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 3 ) || (k == 3  && kn == 1  && j == 1  && jn == 2)) en = 1.45;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 1 ) || (k == 1  && kn == 1  && j == 3  && jn == 2)) en = 1.78;
+    // Santa 3:
+    else if ((k == 1  && kn == 1  && j == 2  && jn == 4 ) || (k == 4  && kn == 2  && j == 1  && jn == 1 )) en = 0.40;
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 1 ) || (k == 1  && kn == 2  && j == 4  && jn == 1 )) en = 0.23;
+    else if ((k == 3  && kn == 1  && j == 4  && jn == 4 ) || (k == 4  && kn == 4  && j == 1  && jn == 3 )) en = 0.23;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 1 ) || (k == 1  && kn == 4  && j == 4  && jn == 3 )) en = 0.70;
+    else if ((k == 4  && kn == 1  && j == 3  && jn == 4 ) || (k == 4  && kn == 3  && j == 1  && jn == 4 )) en = -0.32;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 1 ) || (k == 1  && kn == 3  && j == 4  && jn == 4 )) en = -0.79;
+    else if ((k == 2  && kn == 1  && j == 1  && jn == 4 ) || (k == 4  && kn == 1  && j == 1  && jn == 2 )) en = 0.94;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 1 ) || (k == 1  && kn == 1  && j == 4  && jn == 2 )) en = 1.11;
+    // Santa 4:
+    else if ((k == 1  && kn == 4  && j == 2  && jn == 2 ) || (k == 2  && kn == 2  && j == 4  && jn == 1 )) en = 1.33;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 4 ) || (k == 4  && kn == 2  && j == 2  && jn == 1 )) en = 0.52;
+    else if ((k == 3  && kn == 4  && j == 4  && jn == 2 ) || (k == 2  && kn == 4  && j == 4  && jn == 3 )) en = -0.30;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 4 ) || (k == 4  && kn == 4  && j == 2  && jn == 3 )) en = -0.15;
+    else if ((k == 4  && kn == 4  && j == 3  && jn == 2 ) || (k == 2  && kn == 3  && j == 4  && jn == 4 )) en = -0.05;
+    else if ((k == 4  && kn == 4  && j == 2  && jn == 2 ) || (k == 2  && kn == 2  && j == 4  && jn == 4 )) en = 0.90;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 4 ) || (k == 4  && kn == 3  && j == 2  && jn == 4 )) en = -0.47;
+    else if (k == 4   && kn == 2  && j == 2  && jn == 4 ) en = 1.80;
+    else if ((k == 2  && kn == 4  && j == 1  && jn == 2 ) || (k == 2  && kn == 1  && j == 4  && jn == 2)) en = 0.91;
+    else if (k == 2   && kn == 4  && j == 4  && jn == 2 ) en = 1.21;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 4 ) || (k == 4  && kn == 1  && j == 2  && jn == 2)) en = 0.88;
+    // Santa 5:
+    else if ((k == 1  && kn == 3  && j == 2  && jn == 2) || (k == 2  && kn == 2  && j == 3  && jn == 1 )) en = 1.21;
+    else if ((k == 1  && kn == 2  && j == 2  && jn == 3) || (k == 3  && kn == 2  && j == 2  && jn == 1 )) en = 1.55;
+    else if ((k == 3  && kn == 3  && j == 4  && jn == 2) || (k == 2  && kn == 4  && j == 3  && jn == 3 )) en = 1.28;
+    else if ((k == 3  && kn == 2  && j == 4  && jn == 3) || (k == 3  && kn == 4  && j == 2  && jn == 3 )) en = 0.99;
+    else if ((k == 4  && kn == 3  && j == 3  && jn == 2) || (k == 2  && kn == 3  && j == 3  && jn == 4 )) en = 1.03;
+    else if ((k == 4  && kn == 2  && j == 3  && jn == 3) || (k == 3  && kn == 3  && j == 2  && jn == 4 )) en = 1.44;
+    else if ((k == 2  && kn == 3  && j == 1  && jn == 2) || (k == 2  && kn == 1  && j == 3  && jn == 2 )) en = 1.78;
+    else if ((k == 2  && kn == 2  && j == 1  && jn == 3) || (k == 3  && kn == 1  && j == 2  && jn == 2 )) en = 1.44;
+
+    return en;
+}
+
+// Base codes mapped onto 0..8 so a (k, kn, j, jn) stack packs into a flat table index
+constexpr int kBaseCodes = 9;
+constexpr int baseCodes[kBaseCodes] = {0, 1, 2, 3, 4, 11, 22, 33, 44};
+constexpr int baseIndex(int code) { return code <= 4 ? code : 4 + code / 11; }
+constexpr int packPair(int j, int k, int jn, int kn) {
+    return ((baseIndex(k)*kBaseCodes + baseIndex(kn))*kBaseCodes + baseIndex(j))*kBaseCodes + baseIndex(jn);
+}
+
+using EnergyTable = std::array<double, kBaseCodes*kBaseCodes*kBaseCodes*kBaseCodes>;
+using EnergyFunction = double (*)(int, int, int, int);
+
+// Flat nearest-neighbor table filled at compile time from a reference cascade
+constexpr EnergyTable buildEnergyTable(EnergyFunction reference) {
+    EnergyTable table{};
+    for (int k : baseCodes)
+        for (int kn : baseCodes)
+            for (int j : baseCodes)
+                for (int jn : baseCodes)
+                    table[packPair(j, k, jn, kn)] = reference(j, k, jn, kn);
+    return table;
+}
+
+constexpr EnergyTable energyTable37C = buildEnergyTable(getEnergyReference37C);
+constexpr EnergyTable energyTable55C = buildEnergyTable(getEnergyReference55C);
+
+// Energy model policies: tabulated SantaLucia free energies at 37C and 55C - 0.5M NaCl
+struct Energy37C {
+    static constexpr const char* name = "37C";
+    static constexpr double getEnergy(int j, int k, int jn, int kn) { return energyTable37C[packPair(j, k, jn, kn)]; }
+};
+
+struct Energy55C {
+    static constexpr const char* name = "55C";
+    static constexpr double getEnergy(int j, int k, int jn, int kn) { return energyTable55C[packPair(j, k, jn, kn)]; }
+};
+
+// cross-check the lookup of a policy (packPair into its table) against the reference cascade for
+// every code combination: a packing that sent two stacks to one slot would fail here
+template <class EnergyModel>
+constexpr bool checkEnergyModel(EnergyFunction reference) {
+    for (int k : baseCodes)
+        for (int kn : baseCodes)
+            for (int j : baseCodes)
+                for (int jn : baseCodes)
+                    if (EnergyModel::getEnergy(j, k, jn, kn) != reference(j, k, jn, kn)) return false;
+    return true;
+}
+
+static_assert(checkEnergyModel<Energy37C>(getEnergyReference37C), "Energy37C does not match its reference");
+static_assert(checkEnergyModel<Energy55C>(getEnergyReference55C), "Energy55C does not match its reference");
+// and against stacks of the SantaLucia tables: AA/TT, CG/GC, a stem-loop at/ta and a strand end
+static_assert(Energy37C::getEnergy(2, 1, 2, 1) == -1.55 && Energy37C::getEnergy(4, 3, 3, 4) == -3.53 &&
+              Energy37C::getEnergy(22, 11, 11, 22) == 1.35 && Energy37C::getEnergy(0, 1, 2, 1) == 0.0, "Energy37C lookup");
+static_assert(Energy55C::getEnergy(2, 1, 2, 1) == -0.89 && Energy55C::getEnergy(4, 3, 3, 4) == -2.68 &&
+              Energy55C::getEnergy(22, 11, 11, 22) == 0.71 && Energy55C::getEnergy(0, 1, 2, 1) == 0.0, "Energy55C lookup");
+
+// Two-state nearest-neighbor parameters of every packed stack: dH in kcal/mol, dS in cal/(mol K)
+struct NearestNeighborParams {
+    EnergyTable dH{};
+    EnergyTable dS{};
+};
+
+constexpr double kGasConstant = 1.98720425864083e-3;  // kcal/(mol K)
+constexpr double kelvin(double celsius) { return celsius + 273.15; }
+
+// Temperatures of the tables fitNearestNeighborParams solves from: outside them it extrapolates
+constexpr double kFitLowCelsius = 37.0, kFitHighCelsius = 55.0;
+
+// dH/dS of every stack solved from the tabulated SantaLucia free energies at 37C and 55C
+// (0.5M NaCl), so dG(T) = dH - T*dS reproduces both tables and interpolates between them
+constexpr NearestNeighborParams fitNearestNeighborParams() {
+    NearestNeighborParams params;
+    constexpr double T37 = kelvin(kFitLowCelsius), T55 = kelvin(kFitHighCelsius);
+    for (std::size_t i = 0; i < params.dH.size(); i++) {
+        double dG37 = energyTable37C[i]*kGasConstant*T37;
+        double dG55 = energyTable55C[i]*kGasConstant*T55;
+        double dS = (dG37 - dG55)/(T55 - T37);
+        params.dS[i] = 1000.0*dS;
+        params.dH[i] = dG37 + T37*dS;
+    }
+    return params;
+}
+
+// Read dH/dS from a text file, one stack per line as "5'-k kn-3'/3'-j jn-5' dH dS", e.g. "CA/GT -8.5 -22.7"
+// (lowercase bases for stem-loop regions, # starts a comment). Every stack also sets its rotated
+// equivalent, stacks not listed keep the fitted values.
+inline NearestNeighborParams readNearestNeighborParams(const std::string& fileName) {
+    auto code = [](char c) {
+        switch (c) {
+            case 'A': return 1; case 'T': return 2; case 'C': return 3; case 'G': return 4;
+            case 'a': return 11; case 't': return 22; case 'c': return 33; case 'g': return 44;
+        }
+        return -1;
+    };
+    std::ifstream file(fileName);
+    if (!file) throw std::runtime_error("cannot open " + fileName);
+    NearestNeighborParams params = fitNearestNeighborParams();
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string stack;
+        double dH, dS;
+        if (!(fields >> stack)) continue;
+        if (!(fields >> dH >> dS) || stack.size() != 5 || stack[2] != '/')
+            throw std::runtime_error("bad nearest-neighbor line: " + line);
+        int k = code(stack[0]), kn = code(stack[1]), j = code(stack[3]), jn = code(stack[4]);
+        if (k < 0 || kn < 0 || j < 0 || jn < 0) throw std::runtime_error("bad nearest-neighbor stack: " + stack);
+        for (int i : {packPair(j, k, jn, kn), packPair(kn, jn, k, j)}) {
+            params.dH[i] = dH;
+            params.dS[i] = dS;
+        }
+    }
+    return params;
+}
+
+// dG(T)/kT of every stack at the given temperature
+inline EnergyTable buildEnergyTable(const NearestNeighborParams& params, double celsius) {
+    EnergyTable table{};
+    double T = kelvin(celsius);
+    for (std::size_t i = 0; i < table.size(); i++)
+        table[i] = (params.dH[i] - T*params.dS[i]/1000.0)/(kGasConstant*T);
+    return table;
+}
+
+// Energy tables by temperature, each built once and shared by every run at that temperature
+class EnergyTableCache {
+public:
+    // fitted: params are fitNearestNeighborParams, so temperatures outside 37C..55C get a
+    // warning on stderr when their table is built
+    explicit EnergyTableCache(NearestNeighborParams params, bool fitted = false) : params(params), fitted(fitted) {}
+
+    const EnergyTable& get(double celsius) {
+        long long key = std::llround(celsius*1e6);
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& table = tables[key];
+        if (!table) {
+            if (fitted && (celsius < kFitLowCelsius || celsius > kFitHighCelsius))
+                fprintf(stderr, "Warning: %gC is outside the 37C..55C of the fitted dH/dS, which extrapolate there (--nn-params)\n", celsius);
+            table = std::make_unique<EnergyTable>(buildEnergyTable(params, celsius));
+        }
+        return *table;
+    }
+
+private:
+    NearestNeighborParams params;
+    bool fitted;
+    std::mutex mutex;
+    std::map<long long, std::unique_ptr<EnergyTable>> tables;
+};
+
+// Energy model policy: free energies at an arbitrary temperature from a cached dH/dS table
+struct EnergyNearestNeighbor {
+    static constexpr const char* name = "nearest-neighbor";
+    const EnergyTable* table;
+    double getEnergy(int j, int k, int jn, int kn) const { return (*table)[packPair(j, k, jn, kn)]; }
+};
@@ -0,0 +1,384 @@
+//GILLESPIE ENGINE SHARED BY ALL SIMULATION MODES
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+#include <limits>
+
+#include "energy.hpp"
+#include "rng.hpp"
+#include "profile.hpp"
+#include "trajectory.hpp"
+
+// Events per block of the ensemble runner (runner.hpp), per lane for batched simulations
+constexpr long kBlockEvents = 256;
+
+// Encode a sequence into the strand s1 and its complement s2 (codes in energy.hpp), plus a
+// trailing 0 (no base) so a fraying end at position len reads an unmatched pair
+// Unstructured sequences are coded with capital letters. For example: ACATTTAGAGTAGTCCTTGGAGATTTTATGGAGATG
+// In stem-loop sequences, free tails are coded with capital letters, stem-loop regions are coded with lowercase letters. For example: AAGATGGTGAGTgccatcttAAAACTTACTGGAGAT
+inline void encodeSequence(const std::string& seq, std::vector<int>& s1, std::vector<int>& s2) {
+    s1.clear();
+    s2.clear();
+    for (auto& s : seq) {
+        if (s == 'A') {
+            s1.push_back(1);
+            s2.push_back(2);
+        } else if (s == 'T') {
+            s1.push_back(2);
+            s2.push_back(1);
+        } else if (s == 'C') {
+            s1.push_back(3);
+            s2.push_back(4);
+        } else if (s == 'G') {
+            s1.push_back(4);
+            s2.push_back(3);
+        } else if (s == 'a') {
+            s1.push_back(11);
+            s2.push_back(22);
+        } else if (s == 't') {
+            s1.push_back(22);
+            s2.push_back(11);
+        } else if (s == 'c') {
+            s1.push_back(33);
+            s2.push_back(44);
+        } else if (s == 'g') {
+            s1.push_back(44);
+            s2.push_back(33);
+        }
+    }
+    s1.push_back(0);
+    s2.push_back(0);
+}
+
+// Rightmost and leftmost positions on s1 that can pair in the registry yL - xL
+inline std::pair<int, int> getParams(int yL, int xL, int len) {
+    int registry = yL - xL;
+    int rMax, lMin;
+    if (registry >= 0) {
+        rMax = len - registry;
+        lMin = 1;
+    } else {
+        rMax = len;
+        lMin = 1 - registry;
+    }
+    return std::make_pair(rMax, lMin);
+}
+
+// Sequence packed 3 bits per base, 21 bases per word: bits 0-1 hold the base (A 0, C 1, G 2,
+// T 3, so the complement of a code is code ^ 3), bit 2 is set in stem-loop regions (lowercase)
+struct PackedSequence {
+    static constexpr int kBasesPerWord = 21;
+    int len = 0;
+    std::vector<std::uint64_t> words;
+
+    int packed(int i) const { return int(words[i/kBasesPerWord] >> (3*(i % kBasesPerWord))) & 7; }
+
+    // Base codes of energy.hpp of s1[i] and s2[i] (the complement), 0 past the end like encodeSequence
+    int strand(int i) const { return i < len ? energyCode(packed(i)) : 0; }
+    int complement(int i) const { return i < len ? energyCode(packed(i) ^ 3) : 0; }
+
+    static int energyCode(int code) {
+        static constexpr int codes[8] = {1, 3, 4, 2, 11, 33, 44, 22};
+        return codes[code];
+    }
+};
+
+inline PackedSequence packSequence(const std::string& seq) {
+    static const std::string bases = "ACGTacgt";
+    PackedSequence packed;
+    packed.len = seq.size();
+    packed.words.assign((seq.size() + PackedSequence::kBasesPerWord - 1)/PackedSequence::kBasesPerWord, 0);
+    for (std::size_t i = 0; i < seq.size(); i++) {
+        std::size_t code = bases.find(seq[i]);
+        if (code == std::string::npos) throw std::runtime_error(std::string("unknown base ") + seq[i] + " in " + seq);
+        packed.words[i/PackedSequence::kBasesPerWord] |= std::uint64_t(code) << (3*(i % PackedSequence::kBasesPerWord));
+    }
+    return packed;
+}
+
+// Breaking rates kForm*exp(dG) of the end pair s1[x] with s2[y], stored once per stack: a pair
+// reads its stack (s1[x - 1] s1[x], s2[y - 1] s2[y]) from the neighbor-pair indices step1[x] and
+// step2[y] (packPair of energy.hpp is step1*kStackCodes + step2), so the table has a fixed size
+// for any sequence length. Rows are registries yL - xL from 1 - len with their getParams bounds.
+constexpr int kStackCodes = kBaseCodes*kBaseCodes;
+
+struct RateTable {
+    int len = 0;
+    double kForm = 0.0;
+    std::vector<double> stackRates;
+    std::vector<std::uint8_t> step1;  // positions 0..len, padded for 4-byte vector gathers
+    std::vector<std::uint8_t> step2;
+    std::vector<int> rMaxRow;
+    std::vector<int> lMinRow;
+
+    int row(int yL, int xL) const { return yL - xL + len - 1; }
+    double kBreak(int x, int y) const { return stackRates[step1[x]*kStackCodes + step2[y]]; }
+
+    std::size_t bytes() const {
+        return stackRates.size()*sizeof(double) + step1.size() + step2.size() + (rMaxRow.size() + lMinRow.size())*sizeof(int);
+    }
+};
+
+template <class EnergyModel>
+RateTable buildRateTable(const EnergyModel& model, const PackedSequence& seq, double kForm) {
+    const int len = seq.len;
+    RateTable rates;
+    rates.len = len;
+    rates.kForm = kForm;
+    rates.stackRates.resize(kStackCodes*kStackCodes);
+    for (int k : baseCodes)
+        for (int kn : baseCodes)
+            for (int j : baseCodes)
+                for (int jn : baseCodes)
+                    rates.stackRates[packPair(j, k, jn, kn)] = kForm*exp(model.getEnergy(j, k, jn, kn));
+    rates.step1.assign(len + 4, 0);
+    rates.step2.assign(len + 4, 0);
+    for (int x = 1; x <= len; x++) {
+        rates.step1[x] = baseIndex(seq.strand(x - 1))*kBaseCodes + baseIndex(seq.strand(x));
+        rates.step2[x] = baseIndex(seq.complement(x - 1))*kBaseCodes + baseIndex(seq.complement(x));
+    }
+    rates.rMaxRow.resize(2*len - 1);
+    rates.lMinRow.resize(2*len - 1);
+    for (int registry = 1 - len; registry < len; registry++) {
+        auto [rMax, lMin] = getParams(registry, 0, len);
+        rates.rMaxRow[registry + len - 1] = rMax;
+        rates.lMinRow[registry + len - 1] = lMin;
+    }
+    return rates;
+}
+
+// Trajectory state: s1[xL..xR] is paired with s2[yL..yR] in registry g, t is the time of the
+// current event; the duplex of registry g is fully zipped at full = len - |g| pairs
+struct State {
+    int xL = 0, xR = 0;
+    int yL = 0, yR = 0;
+    int g = 0;
+    int hBonds = 0;
+    double t = 0.0;
+    int full = 0;
+};
+
+// Nucleation policies: pick the first contact (x, y) of a new duplex; rate(rates) is the total
+// nucleation rate, kForm for each of the len^2 contacts of the strands (nucleation.hpp has
+// sequence-dependent policies)
+
+// Registry time: a random contact with x != y, both in [1, len]
+struct MisregisteredNucleation {
+    std::uniform_int_distribution<int> distInt;
+
+    MisregisteredNucleation(const RateTable& rates, int, int) : distInt(1, rates.len) {}
+
+    static double rate(const RateTable& rates) { return double(rates.len*rates.len)*rates.kForm; }
+
+    template <class Rng>
+    std::pair<int, int> operator()(Rng& mt) {
+        int x, y;
+        // make sure x != y
+        while (true) {
+            x = distInt(mt);
+            y = distInt(mt);
+            if (x != y) break;
+        }
+        return std::make_pair(x, y);
+    }
+};
+
+// Zipping time: an in-registry contact x == y in [num1, num2]
+struct InRegistryNucleation {
+    std::uniform_int_distribution<int> distInt;
+
+    InRegistryNucleation(const RateTable&, int num1, int num2) : distInt(num1, num2) {}
+
+    static double rate(const RateTable& rates) { return double(rates.len*rates.len)*rates.kForm; }
+
+    template <class Rng>
+    std::pair<int, int> operator()(Rng& mt) {
+        int x = distInt(mt);
+        return std::make_pair(x, x);
+    }
+};
+
+// Absorbing conditions, checked after every event: report an absorbing event through
+// record(g, t), reset the trajectory and return true
+
+// Registry time: the misregistered duplex melts
+struct RegistryAbsorption {
+    static constexpr bool recordsRegistry = true;
+
+    template <class Record>
+    static bool absorb(State& s, Record& record) {
+        if (s.hBonds == 0) {
+            record(s.g, s.t);
+            s.g = 0; s.t = 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Successful zipping time: the duplex zips fully, time spent in failed attempts included
+struct SuccessfulAbsorption {
+    static constexpr bool recordsRegistry = false;
+
+    template <class Record>
+    static bool absorb(State& s, Record& record) {
+        if (s.hBonds == s.full) {
+            record(s.g, s.t);
+            s.t = 0;
+            s.xR = s.xL = 0;
+            s.yR = s.yL = 0;
+            return true;
+        }
+        return false;
+    }
+};
+
+// Failed zipping time: the nucleus melts before zipping, fully zipped attempts are discarded
+struct FailedAbsorption {
+    static constexpr bool recordsRegistry = false;
+
+    template <class Record>
+    static bool absorb(State& s, Record& record) {
+        if (s.hBonds == 0) {
+            record(s.g, s.t);
+            s.t = 0;
+            s.xR = s.xL = 0;
+            s.yR = s.yL = 0;
+            return true;
+        }
+        if (s.hBonds == s.full) {
+            s.t = 0;
+            s.xR = s.xL = 0;
+            s.yR = s.yL = 0;
+        }
+        return false;
+    }
+};
+
+// One move of a nucleated trajectory drawn with the uniform randNum: an end pair frays (a nucleus
+// whose last pair frays melts to xL = xR = 0) or the next pair zips. Returns the move code
+// (trajectory.hpp) and the total rate kTotal of the state it left.
+inline int gillespieMove(State& s, const RateTable& rates, double randNum, double& kTotal) {
+    const double kForm = rates.kForm;
+    int row = rates.row(s.yL, s.xL);
+    int rMax = rates.rMaxRow[row];
+    int lMin = rates.lMinRow[row];
+    double kB1 = rates.kBreak(s.xL, s.yL);
+    double kB2 = (s.xR == s.xL) ? 0.0 : rates.kBreak(s.xR, s.yR);
+    double kFL = (s.xL == lMin) ? 0.0 : kForm;
+    double kFR = (s.xR == rMax) ? 0.0 : kForm;
+    kTotal = kB1 + kB2 + kFL + kFR;
+    double r = randNum*kTotal;
+    if (r <= kB1) {
+        s.xL++; s.yL++; s.hBonds--;
+        if (s.hBonds == 0) {
+            s.xR = s.xL = 0;
+            s.yR = s.yL = 0;
+        }
+        profile::move(0, kTotal, false);
+        return kFrayLeft;
+    } else if (r <= kB1 + kB2) {
+        s.xR--; s.yR--; s.hBonds--;
+        profile::move(1, kTotal, false);
+        return kFrayRight;
+    } else if (r <= kB1 + kB2 + kFL) {
+        s.xL--; s.yL--; s.hBonds++;
+        profile::move(2, kTotal, s.xL == lMin && s.xR == rMax);
+        return kZipLeft;
+    }
+    s.xR++; s.yR++; s.hBonds++;
+    profile::move(3, kTotal, s.xL == lMin && s.xR == rMax);
+    return kZipRight;
+}
+
+// Gillespie simulation of one trajectory stream; the energy model, nucleation strategy and
+// absorbing condition are policies so every mode compiles to its own specialized loop, and the
+// recorder (trajectory.hpp) sees every nucleation and move of --trace
+template <class EnergyModel, class Nucleation, class Absorption, class Recorder = NoRecorder>
+class Simulation {
+public:
+    static constexpr long blockEvents = kBlockEvents;
+
+    Simulation(const RateTable& rates, Nucleation nucleation, double time, Recorder recorder = Recorder())
+        : recorder(recorder), rates(rates), nucleation(nucleation), time(time) {}
+
+    static RateTable buildRates(const EnergyModel& model, const PackedSequence& seq, double kForm) {
+        return buildRateTable(model, seq, kForm);
+    }
+
+    // Block b of the ensemble runner is about to run, for the recorder
+    void startBlock(long block) { recorder.startBlock(block); }
+
+    // Run until stopCondition absorbing events were recorded, one event exceeds the time cap or
+    // maxSteps steps were taken; returns the number of recorded events
+    template <class Rng, class Record>
+    long run(long stopCondition, Rng& mt, Record&& record) {
+        State& s = state;
+        long step = 0;
+        const int len = rates.len;
+        VariateBuffer<Rng> variates(mt);
+        const double kNucleation = nucleation.rate(rates);
+        long success = 0;
+        // steps and nucleations of the current event, for the profile (profile.hpp)
+        long eventSteps = 0;
+        long eventNucleations = 0;
+        auto recordEvent = [&](int g, double t) {
+            recorder.event(g, t);
+            record(g, t);
+        };
+
+        while (s.t < time) {
+            if (s.xL == 0 && s.xR == 0) {
+                auto [x, y] = nucleation(mt);
+                s.g = y - x;
+                s.xL = x; s.xR = x;
+                s.yL = y; s.yR = y;
+                s.hBonds = 1;
+                s.full = len - std::abs(s.g);
+                double wait = variates.exponential()/kNucleation;
+                s.t += wait;
+                recorder.nucleation(x, y, wait);
+                profile::nucleation();
+                eventNucleations++;
+            }
+            else {
+                double kTotal;
+                int move = gillespieMove(s, rates, variates.uniform(), kTotal);
+                double wait = variates.exponential()/kTotal;
+                s.t += wait;
+                recorder.move(move, wait);
+            }
+            step++;
+            eventSteps++;
+            if (Absorption::absorb(s, recordEvent)) {
+                success++;
+                profile::event(eventSteps, eventNucleations);
+                eventSteps = eventNucleations = 0;
+            } else if constexpr (Recorder::enabled) {
+                // an attempt reset without an event (a zipped attempt of the failed mode)
+                if (s.xL == 0 && s.hBonds != 0) recorder.discard();
+            }
+            if (success == stopCondition || step == maxSteps) break;
+        }
+        steps += step;
+        recorder.endRun();
+        return success;
+    }
+
+    State state;
+    long steps = 0;  // events of all runs, nucleations included
+    long maxSteps = std::numeric_limits<long>::max();  // step budget of a run (kBench)
+    Recorder recorder;
+
+private:
+    const RateTable& rates;
+    Nucleation nucleation;
+    double time;
+};
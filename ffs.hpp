@@ -0,0 +1,127 @@
+//FORWARD FLUX SAMPLING OF SUCCESSFUL ZIPPING
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "engine.hpp"
+#include "rng.hpp"
+#include "pool.hpp"
+
+// Most interfaces after lambda_0: stage i draws from the streams streamBase + (i << 32) + c, which
+// must stay below the next run's streamBase + (1 << 40) (runTemperatures)
+constexpr int kMaxFfsInterfaces = 255;
+
+// Interfaces on the order parameter hBonds for an in-registry nucleus of len pairs: lambda_0 = 1
+// (a nucleation) up to lambda_n = len (fully zipped), n of them spaced evenly
+inline std::vector<int> ffsInterfaces(int len, int n) {
+    n = std::max(1, std::min(n, len - 1));
+    std::vector<int> interfaces{1};
+    for (int i = 1; i <= n; i++) {
+        int lambda = 1 + int(std::lround(double(len - 1)*i/n));
+        if (lambda > interfaces.back()) interfaces.push_back(lambda);
+    }
+    return interfaces;
+}
+
+// Stage i of the sampling: trials from the configurations that reached lambda_(i-1), of which
+// successes went on to lambda_i before melting
+struct FfsStage {
+    int lambda = 0;
+    long trials = 0;
+    long successes = 0;
+    double p() const { return trials ? double(successes)/trials : 0.0; }
+};
+
+struct FfsResult {
+    double flux = 0.0;      // rate of crossing lambda_0 out of the melted strands: the nucleation rate
+    std::vector<FfsStage> stages;
+    double success = 0.0;   // probability that a nucleus zips fully, the product of the stage p
+    double error = 0.0;     // relative standard error of success, infinite when a stage had no successes
+};
+
+// Direct forward flux sampling of the in-registry chain of Simulation (the same moves through
+// gillespieMove, the same Nucleation policy). Every nucleation crosses lambda_0, so the flux is
+// the nucleation rate and stage 0 keeps trials nuclei drawn from the policy. Stage i starts
+// trials trajectories from configurations of stage i - 1 picked at random and runs each until it
+// reaches lambda_i or melts (hBonds == 0), so the product of the stage probabilities is an
+// unbiased estimate of the zipping probability however rare it is. Trials are simulated in
+// chunks of kChunk on the work-stealing pool, chunk c of stage i drawing from the stream
+// (seed, streamBase + (i << 32) + c), so the result does not depend on the number of threads;
+// at most kMaxFfsInterfaces stages keep these streams within the run's 2^40 streams.
+template <class Rng, class Nucleation>
+FfsResult forwardFlux(const RateTable& rates, Nucleation nucleation, const std::vector<int>& interfaces, long trials,
+                      std::uint64_t seed, std::uint64_t streamBase, int threads) {
+    constexpr long kChunk = 256;
+    if (interfaces.size() > std::size_t(kMaxFfsInterfaces) + 1) throw std::runtime_error("ffs takes at most 255 interfaces");
+    FfsResult result;
+    result.flux = nucleation.rate(rates);
+    const long chunks = (trials + kChunk - 1)/kChunk;
+
+    // configurations at the last interface reached, in trial order
+    std::vector<State> reached(trials);
+    std::vector<char> hit(trials, 0);
+    {
+        Rng mt(seed, streamBase);
+        for (long j = 0; j < trials; j++) {
+            auto [x, y] = nucleation(mt);
+            State& s = reached[j];
+            s.xL = s.xR = x;
+            s.yL = s.yR = y;
+            s.g = y - x;
+            s.hBonds = 1;
+            s.full = rates.len - std::abs(s.g);
+        }
+    }
+    FfsStage first;
+    first.lambda = interfaces[0];
+    first.trials = first.successes = trials;
+    result.stages.push_back(first);
+
+    double variance = 0.0;
+    result.success = 1.0;
+    for (std::size_t i = 1; i < interfaces.size(); i++) {
+        const int lambda = interfaces[i];
+        const std::size_t starts = reached.size();
+        std::vector<State> next(trials);
+        std::fill(hit.begin(), hit.end(), 0);
+        runWorkStealing(chunks, threads, [&](std::size_t c) {
+            Rng mt(seed, streamBase + (std::uint64_t(i) << 32) + c);
+            for (long j = c*kChunk; j < std::min(trials, long(c + 1)*kChunk); j++) {
+                State s = reached[std::min(starts - 1, std::size_t(mt.uniform()*starts))];
+                double kTotal;
+                while (s.hBonds > 0 && s.hBonds < lambda) gillespieMove(s, rates, mt.uniform(), kTotal);
+                if (s.hBonds >= lambda) {
+                    next[j] = s;
+                    hit[j] = 1;
+                }
+            }
+        });
+
+        FfsStage stage;
+        stage.lambda = lambda;
+        stage.trials = trials;
+        reached.clear();
+        for (long j = 0; j < trials; j++) {
+            if (hit[j]) reached.push_back(next[j]);
+        }
+        stage.successes = reached.size();
+        result.stages.push_back(stage);
+        result.success *= stage.p();
+        if (stage.successes == 0) {
+            // success 0 is only a bound below 1/trials of the stage: no error estimate
+            result.error = std::numeric_limits<double>::infinity();
+            return result;
+        }
+        // relative variance of a product of independent binomial estimates, which leaves out the
+        // correlation of trials sharing a starting configuration
+        variance += (1.0 - stage.p())/(stage.p()*trials);
+    }
+    result.error = std::sqrt(variance);
+    return result;
+}
@@ -0,0 +1,205 @@
+//kdna LIBRARY: THE ENGINE BEHIND Simulator (kdna.hpp) AND ITS C ABI (kdna.h)
+//
+//   g++ -std=c++17 -O3 -pthread -fPIC -shared kdna.cpp -o libkdna.so
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+
+#include "kdna.hpp"
+#include "kdna.h"
+#include "energy.hpp"
+#include "engine.hpp"
+#include "runner.hpp"
+#include "batch.hpp"
+#include "nucleation.hpp"
+
+// Type-erased simulation of one configuration
+struct Simulator::Engine {
+    SimulatorConfig config;
+
+    explicit Engine(const SimulatorConfig& config) : config(config) {}
+    virtual ~Engine() = default;
+    virtual long run(long events, int* registries, double* times) = 0;
+    virtual long blockEvents() const = 0;
+};
+
+namespace {
+
+// The rate table and prototype simulation of one policy set; run n takes the next blocks of
+// RNG streams after those of the runs before it
+template <class Rng, class Sim, class EnergyModel, class Nucleation>
+class EnsembleEngine : public Simulator::Engine {
+public:
+    EnsembleEngine(const SimulatorConfig& config, const EnergyModel& model, double time)
+        : Engine(config), rates(buildRateTable(model, packSequence(config.seq), config.kForm)),
+          simulation(rates, Nucleation(rates, config.num1 ? config.num1 : 1, config.num2 ? config.num2 : rates.len), time) {}
+
+    long run(long events, int* registries, double* times) override {
+        if (events <= 0) return 0;
+        long n = 0;
+        auto emit = [&](int g, double t) {
+            if (registries) registries[n] = g;
+            times[n++] = t;
+        };
+        runEnsemble<Rng>(simulation, events, config.seed, nextStream, std::max(config.threads, 1), emit);
+        nextStream += (events + Sim::blockEvents - 1)/Sim::blockEvents;
+        return n;
+    }
+
+    long blockEvents() const override { return Sim::blockEvents; }
+
+private:
+    RateTable rates;
+    Sim simulation;
+    std::uint64_t nextStream = 0;
+};
+
+template <class Rng, class EnergyModel, class Nucleation, class Absorption>
+std::unique_ptr<Simulator::Engine> makeBatch(const SimulatorConfig& config, const EnergyModel& model, double time) {
+    switch (config.batch) {
+        case 0: return std::make_unique<EnsembleEngine<Rng, Simulation<EnergyModel, Nucleation, Absorption>, EnergyModel, Nucleation>>(config, model, time);
+        case 4: return std::make_unique<EnsembleEngine<Rng, BatchSimulation<EnergyModel, Nucleation, Absorption, 4>, EnergyModel, Nucleation>>(config, model, time);
+        case 8: return std::make_unique<EnsembleEngine<Rng, BatchSimulation<EnergyModel, Nucleation, Absorption, 8>, EnergyModel, Nucleation>>(config, model, time);
+        case 16: return std::make_unique<EnsembleEngine<Rng, BatchSimulation<EnergyModel, Nucleation, Absorption, 16>, EnergyModel, Nucleation>>(config, model, time);
+    }
+    throw std::runtime_error("batch must be 0, 4, 8 or 16");
+}
+
+template <class EnergyModel, class Nucleation, class Absorption>
+std::unique_ptr<Simulator::Engine> makeRng(const SimulatorConfig& config, const EnergyModel& model, double time) {
+    if (config.rng == "xoshiro") return makeBatch<Xoshiro256pp, EnergyModel, Nucleation, Absorption>(config, model, time);
+    if (config.rng == "philox") return makeBatch<Philox, EnergyModel, Nucleation, Absorption>(config, model, time);
+    throw std::runtime_error("unknown rng " + config.rng + " (xoshiro or philox)");
+}
+
+// The policy choice of runEnergyModel in Simulation.cpp
+template <class EnergyModel>
+std::unique_ptr<Simulator::Engine> makeEngine(const SimulatorConfig& config, const EnergyModel& model, double time) {
+    bool stability = config.nucleation == "stability";
+    if (!stability && config.nucleation != "uniform") throw std::runtime_error("unknown nucleation " + config.nucleation + " (uniform or stability)");
+    if (config.mode == "registry") {
+        if (stability) return makeRng<EnergyModel, StabilityMisregisteredNucleation, RegistryAbsorption>(config, model, time);
+        return makeRng<EnergyModel, MisregisteredNucleation, RegistryAbsorption>(config, model, time);
+    }
+    if (config.mode == "successful") {
+        if (stability) return makeRng<EnergyModel, StabilityInRegistryNucleation, SuccessfulAbsorption>(config, model, time);
+        return makeRng<EnergyModel, InRegistryNucleation, SuccessfulAbsorption>(config, model, time);
+    }
+    if (config.mode == "failed") {
+        if (stability) return makeRng<EnergyModel, StabilityInRegistryNucleation, FailedAbsorption>(config, model, time);
+        return makeRng<EnergyModel, InRegistryNucleation, FailedAbsorption>(config, model, time);
+    }
+    throw std::runtime_error("unknown mode " + config.mode + " (registry, successful or failed)");
+}
+
+}  // namespace
+
+Simulator::Simulator(const SimulatorConfig& config) {
+    if (config.seq.empty()) throw std::runtime_error("no sequence");
+    int len = config.seq.size();
+    if (config.num1 < 0 || config.num2 < 0 || config.num1 > len || config.num2 > len || (config.num1 && config.num2 && config.num1 > config.num2))
+        throw std::runtime_error("nucleation window outside the sequence");
+    if (!(config.kForm > 0.0)) throw std::runtime_error("kForm must be positive");
+
+    // the time caps of kDNA; the rate table holds the breaking rates, so the energy table of a
+    // temperature is only needed while it is built
+    if (config.nearestNeighbor) {
+        NearestNeighborParams params = config.nnParams.empty() ? fitNearestNeighborParams() : readNearestNeighborParams(config.nnParams);
+        EnergyTable table = buildEnergyTable(params, config.temperature);
+        engine = makeEngine(config, EnergyNearestNeighbor{&table}, 10000000.0);
+    } else if (config.table == "37C") {
+        engine = makeEngine(config, Energy37C{}, config.mode == "registry" ? 1000000.0 : 10000000.0);
+    } else if (config.table == "55C") {
+        engine = makeEngine(config, Energy55C{}, 10000000.0);
+    } else {
+        throw std::runtime_error("unknown table " + config.table + " (37C or 55C)");
+    }
+}
+
+Simulator::~Simulator() = default;
+Simulator::Simulator(Simulator&&) noexcept = default;
+Simulator& Simulator::operator=(Simulator&&) noexcept = default;
+
+long Simulator::run(long events, int* registries, double* times) { return engine->run(events, registries, times); }
+
+long Simulator::blockEvents() const { return engine->blockEvents(); }
+
+const SimulatorConfig& Simulator::config() const { return engine->config; }
+
+// C ABI: exceptions stop here and leave their message in kdna_last_error()
+
+struct kdna_simulator {
+    Simulator simulator;
+};
+
+namespace {
+thread_local std::string lastError;
+}
+
+extern "C" {
+
+void kdna_config_init(kdna_config* config) {
+    SimulatorConfig defaults;
+    *config = kdna_config{};
+    config->nearest_neighbor = defaults.nearestNeighbor;
+    config->temperature = defaults.temperature;
+    config->kform = defaults.kForm;
+    config->batch = defaults.batch;
+    config->threads = defaults.threads;
+    config->seed = defaults.seed;
+}
+
+kdna_simulator* kdna_create(const kdna_config* config) {
+    lastError.clear();
+    try {
+        if (!config) throw std::runtime_error("null config");
+        SimulatorConfig c;
+        if (config->seq) c.seq = config->seq;
+        if (config->mode) c.mode = config->mode;
+        if (config->table) c.table = config->table;
+        c.nearestNeighbor = config->nearest_neighbor != 0;
+        c.temperature = config->temperature;
+        if (config->nn_params) c.nnParams = config->nn_params;
+        c.kForm = config->kform;
+        c.num1 = config->num1;
+        c.num2 = config->num2;
+        if (config->nucleation) c.nucleation = config->nucleation;
+        if (config->rng) c.rng = config->rng;
+        c.batch = config->batch;
+        c.threads = config->threads;
+        c.seed = config->seed;
+        return new kdna_simulator{Simulator(c)};
+    } catch (const std::exception& e) {
+        lastError = e.what();
+        return nullptr;
+    }
+}
+
+void kdna_destroy(kdna_simulator* simulator) { delete simulator; }
+
+long kdna_run(kdna_simulator* simulator, long events, int* registries, double* times) {
+    lastError.clear();
+    try {
+        if (!simulator) throw std::runtime_error("null simulator");
+        return simulator->simulator.run(events, registries, times);
+    } catch (const std::exception& e) {
+        lastError = e.what();
+        return -1;
+    }
+}
+
+long kdna_block_events(const kdna_simulator* simulator) {
+    lastError.clear();
+    if (!simulator) {
+        lastError = "null simulator";
+        return -1;
+    }
+    return simulator->simulator.blockEvents();
+}
+
+const char* kdna_last_error(void) { return lastError.c_str(); }
+
+}
@@ -0,0 +1,52 @@
+/* C ABI OF THE kdna LIBRARY (kdna.cpp), A THIN LAYER OVER Simulator OF kdna.hpp */
+
+#ifndef KDNA_H
+#define KDNA_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Fields of SimulatorConfig; null strings keep their default. Fill with kdna_config_init first. */
+typedef struct kdna_config {
+    const char* seq;
+    const char* mode;          /* registry, successful or failed */
+    const char* table;         /* 37C or 55C, when nearest_neighbor is 0 */
+    int nearest_neighbor;      /* 1: free energies at temperature from dH/dS */
+    double temperature;        /* in C; the fitted dH/dS extrapolate outside 37..55 */
+    const char* nn_params;     /* dH/dS file, the fitted values when null */
+    double kform;
+    int num1;                  /* nucleation window of the zipping modes, 0 for the whole sequence */
+    int num2;
+    const char* nucleation;    /* uniform or stability */
+    const char* rng;           /* xoshiro or philox */
+    int batch;                 /* 0, 4, 8 or 16 */
+    int threads;
+    uint64_t seed;
+} kdna_config;
+
+typedef struct kdna_simulator kdna_simulator;
+
+void kdna_config_init(kdna_config* config);
+
+/* Returns null on an invalid or null configuration, with the reason in kdna_last_error() */
+kdna_simulator* kdna_create(const kdna_config* config);
+void kdna_destroy(kdna_simulator* simulator);
+
+/* Simulates up to events events into registries (may be null) and times; returns the number
+   written, fewer only when the time cap was reached, or -1 on error (a null simulator too) */
+long kdna_run(kdna_simulator* simulator, long events, int* registries, double* times);
+
+/* Events per RNG block of the simulator, -1 for a null simulator */
+long kdna_block_events(const kdna_simulator* simulator);
+
+/* Message of the last failed call on this thread, "" when there is none */
+const char* kdna_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
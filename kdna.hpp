@@ -0,0 +1,51 @@
+//EMBEDDABLE SIMULATOR (C++ API OF THE kdna LIBRARY)
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Everything that selects a run; the defaults are those of the command line
+struct SimulatorConfig {
+    std::string seq;
+    std::string mode = "registry";         // registry, successful or failed
+    std::string table = "37C";             // 37C or 55C, unless nearestNeighbor
+    bool nearestNeighbor = false;          // free energies at temperature from dH/dS (--temp)
+    double temperature = 37.0;             // in C
+    std::string nnParams;                  // dH/dS file of --nn-params, the fitted values when empty
+    double kForm = 1e9;
+    int num1 = 0;                          // nucleation window of the zipping modes, 0 for the
+    int num2 = 0;                          // whole sequence
+    std::string nucleation = "uniform";    // uniform or stability
+    std::string rng = "xoshiro";           // xoshiro or philox
+    int batch = 0;                         // 0, or 4, 8 or 16 lockstep lanes (--batch)
+    int threads = 1;
+    std::uint64_t seed = 0;
+};
+
+// A configured simulation: the rate table, nucleation policy and time cap are built once, then
+// every run(n) simulates the next n events. Events come from the blocks of the ensemble runner
+// (runner.hpp) in stream order, so runs whose sizes are multiples of blockEvents() give the
+// events of one `kDNA --seed seed` run of the same total, for any number of threads. Invalid
+// configurations throw std::runtime_error from the constructor.
+class Simulator {
+public:
+    explicit Simulator(const SimulatorConfig& config);
+    ~Simulator();
+    Simulator(Simulator&&) noexcept;
+    Simulator& operator=(Simulator&&) noexcept;
+
+    // Simulates up to events absorbing events into registries[i] (the registry g in registry
+    // mode, 0 otherwise; may be null) and times[i]; returns the number written, less than
+    // events only when an event reached the time cap, which ends that run like it ends kDNA
+    long run(long events, int* registries, double* times);
+
+    long blockEvents() const;
+    const SimulatorConfig& config() const;
+
+    struct Engine;
+
+private:
+    std::unique_ptr<Engine> engine;
+};
@@ -0,0 +1,198 @@
+//SEQUENCE-DEPENDENT NUCLEATION WITH ALIAS TABLES
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include <algorithm>
+
+#include "engine.hpp"
+
+// Walker's alias method (Vose's construction): index i of n with probability weights[i]/sum
+// from one uniform, in constant time
+class AliasTable {
+public:
+    AliasTable() = default;
+
+    explicit AliasTable(const std::vector<double>& weights) : probability(weights.size(), 1.0), alias(weights.size()) {
+        const int n = weights.size();
+        double sum = 0.0;
+        for (double w : weights) sum += w;
+        std::vector<double> scaled(n);
+        std::vector<int> small, large;
+        for (int i = 0; i < n; i++) {
+            alias[i] = i;
+            scaled[i] = sum > 0.0 ? weights[i]*n/sum : 0.0;
+            (scaled[i] < 1.0 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            int s = small.back(), l = large.back();
+            small.pop_back();
+            probability[s] = scaled[s];
+            alias[s] = l;
+            scaled[l] -= 1.0 - scaled[s];
+            if (scaled[l] < 1.0) {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // what is left has probability 1 up to rounding
+    }
+
+    // u uniform in [0, 1): its integer part (times n) picks a column, the fraction the coin
+    int sample(double u) const {
+        double column = u*probability.size();
+        int i = std::min(int(column), int(probability.size()) - 1);
+        return (column - i < probability[i]) ? i : alias[i];
+    }
+
+private:
+    std::vector<double> probability;
+    std::vector<int> alias;
+};
+
+// Weight of a first contact (x, y): the chance kForm/(kForm + kBreak) that the next pair forms
+// before the contact breaks, from the breaking rate of its stack in the rate table. A contact
+// nucleates at rate kForm times its weight, so the weights only depend on the stack class
+// (step1[x], step2[y]) of the contact.
+inline double contactWeight(const RateTable& rates, int stack) {
+    return rates.kForm/(rates.kForm + rates.stackRates[stack]);
+}
+
+// Total nucleation rate over the len^2 contacts of the strands, like the len^2 kForm of the
+// uniform policies
+inline double contactRate(const RateTable& rates) {
+    std::vector<double> count1(kStackCodes, 0.0), count2(kStackCodes, 0.0);
+    for (int x = 1; x <= rates.len; x++) {
+        count1[rates.step1[x]]++;
+        count2[rates.step2[x]]++;
+    }
+    double rate = 0.0;
+    for (int a = 0; a < kStackCodes; a++) {
+        if (count1[a] == 0.0) continue;
+        for (int b = 0; b < kStackCodes; b++) rate += count1[a]*count2[b]*contactWeight(rates, a*kStackCodes + b);
+    }
+    return rate*rates.kForm;
+}
+
+// Registry time with stability-weighted contacts x != y. The len^2 contacts are never listed:
+// an alias table picks the stack class (a, b) of the contact, weighted by the number of its
+// contacts, then a contact of the class is drawn uniformly without rejection. Positions are
+// grouped by step1 class and, within a class, by step2 class, so the x of class a that could
+// pair with themselves (step2[x] == b) form one block that is handled apart.
+class StabilityMisregisteredNucleation {
+public:
+    StabilityMisregisteredNucleation(const RateTable& rates, int, int) : sites(std::make_shared<Sites>(rates)) {}
+
+    static double rate(const RateTable& rates) { return contactRate(rates); }
+
+    template <class Rng>
+    std::pair<int, int> operator()(Rng& mt) {
+        const Sites& c = *sites;
+        int k = c.classes.sample(mt.uniform());
+        int a = k/kStackCodes, b = k % kStackCodes;
+        long n2 = c.yStart[b + 1] - c.yStart[b];
+        int block = c.blockStart[k], d = c.blockEnd[k] - block;
+        long inner = long(d)*(n2 - 1);
+        long u = std::min(long(mt.uniform()*c.pairs[k]), c.pairs[k] - 1);
+        int x, j;
+        if (u < inner) {
+            // x in the block: every y of class b but x itself
+            x = c.xByClass[block + u/(n2 - 1)];
+            j = u % (n2 - 1);
+            if (j >= c.yIndex[x]) j++;
+        } else {
+            // x of class a outside the block: every y of class b
+            u -= inner;
+            int i = c.xStart[a] + u/n2;
+            if (i >= block) i += d;
+            x = c.xByClass[i];
+            j = u % n2;
+        }
+        return std::make_pair(x, c.yByClass[c.yStart[b] + j]);
+    }
+
+private:
+    struct Sites {
+        std::vector<int> xByClass, xStart;  // positions by step1 class, then step2 class
+        std::vector<int> yByClass, yStart, yIndex;  // positions by step2 class, index of x in its class
+        std::vector<int> blockStart, blockEnd;  // x of class a with step2 class b, per a*kStackCodes + b
+        std::vector<long> pairs;  // contacts x != y of each class pair
+        AliasTable classes;
+
+        explicit Sites(const RateTable& rates) {
+            const int len = rates.len;
+            xStart.assign(kStackCodes + 1, 0);
+            yStart.assign(kStackCodes + 1, 0);
+            for (int x = 1; x <= len; x++) {
+                xStart[rates.step1[x] + 1]++;
+                yStart[rates.step2[x] + 1]++;
+            }
+            for (int a = 0; a < kStackCodes; a++) {
+                xStart[a + 1] += xStart[a];
+                yStart[a + 1] += yStart[a];
+            }
+            // counting sort by (step1, step2) for x, by step2 for y
+            std::vector<int> blockCount(kStackCodes*kStackCodes, 0);
+            for (int x = 1; x <= len; x++) blockCount[rates.step1[x]*kStackCodes + rates.step2[x]]++;
+            blockStart.assign(kStackCodes*kStackCodes, 0);
+            blockEnd.assign(kStackCodes*kStackCodes, 0);
+            for (int a = 0; a < kStackCodes; a++) {
+                int offset = xStart[a];
+                for (int b = 0; b < kStackCodes; b++) {
+                    blockStart[a*kStackCodes + b] = blockEnd[a*kStackCodes + b] = offset;
+                    offset += blockCount[a*kStackCodes + b];
+                }
+            }
+            xByClass.assign(len, 0);
+            yByClass.assign(len, 0);
+            yIndex.assign(len + 1, 0);
+            std::vector<int> yNext(yStart.begin(), yStart.end() - 1);
+            for (int x = 1; x <= len; x++) {
+                xByClass[blockEnd[rates.step1[x]*kStackCodes + rates.step2[x]]++] = x;
+                yIndex[x] = yNext[rates.step2[x]] - yStart[rates.step2[x]];
+                yByClass[yNext[rates.step2[x]]++] = x;
+            }
+
+            pairs.assign(kStackCodes*kStackCodes, 0);
+            std::vector<double> weights(kStackCodes*kStackCodes, 0.0);
+            for (int a = 0; a < kStackCodes; a++) {
+                long n1 = xStart[a + 1] - xStart[a];
+                for (int b = 0; b < kStackCodes; b++) {
+                    int k = a*kStackCodes + b;
+                    long n2 = yStart[b + 1] - yStart[b];
+                    pairs[k] = n1*n2 - (blockEnd[k] - blockStart[k]);
+                    weights[k] = pairs[k]*contactWeight(rates, k);
+                }
+            }
+            classes = AliasTable(weights);
+        }
+    };
+
+    std::shared_ptr<const Sites> sites;
+};
+
+// Zipping time with stability-weighted in-registry contacts x == y in [num1, num2], from an
+// alias table over the window
+class StabilityInRegistryNucleation {
+public:
+    StabilityInRegistryNucleation(const RateTable& rates, int num1, int num2) : first(num1) {
+        std::vector<double> weights;
+        for (int x = num1; x <= num2; x++) weights.push_back(contactWeight(rates, rates.step1[x]*kStackCodes + rates.step2[x]));
+        sites = std::make_shared<const AliasTable>(weights);
+    }
+
+    static double rate(const RateTable& rates) { return contactRate(rates); }
+
+    template <class Rng>
+    std::pair<int, int> operator()(Rng& mt) {
+        int x = first + sites->sample(mt.uniform());
+        return std::make_pair(x, x);
+    }
+
+private:
+    int first;
+    std::shared_ptr<const AliasTable> sites;
+};
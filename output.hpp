@@ -0,0 +1,127 @@
+//BUFFERED OUTPUT OF ABSORBING EVENTS
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+
+// Binary event files: a header, then fixed-width little-endian records from byte headerBytes on,
+// so numpy can map them directly:
+//     np.memmap(file, dtype=[("registry", "<i4"), ("time", "<f8")], offset=headerBytes)
+//
+//   char[8]  magic "KDNAEVT\0"
+//   uint32   version (1)
+//   uint32   headerBytes, a multiple of 8
+//   uint32   recordBytes (12: int32 registry + float64 time, no padding)
+//   uint32   length of the metadata text
+//   char[]   metadata, "key=value" lines (fields, mode, energy, seq, seed, ...), NUL padded
+constexpr char kEventMagic[8] = {'K', 'D', 'N', 'A', 'E', 'V', 'T', '\0'};
+constexpr std::uint32_t kEventVersion = 1;
+constexpr std::uint32_t kEventRecordBytes = 12;
+
+// Writes events as text ("g t" or "t" lines like printf did, after an optional prefix) or as
+// binary records, through one large buffer flushed with fwrite
+class OutputWriter {
+public:
+    static constexpr std::size_t kBufferBytes = 1 << 20;
+
+    OutputWriter(FILE* file, bool binary, bool recordsRegistry, std::string prefix = "")
+        : file(file), binary(binary), recordsRegistry(recordsRegistry), prefix(std::move(prefix)),
+          recordBytes(this->prefix.size() + kMaxNumberBytes), buffer(std::max(kBufferBytes, recordBytes)) {}
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    ~OutputWriter() { flush(); }
+
+    // Binary files only; metadata is a list of key/value pairs
+    void writeHeader(const std::vector<std::pair<std::string, std::string>>& metadata) {
+        if (!binary) return;
+        std::string text = "fields=registry:int32,time:float64\n";
+        for (auto& [key, value] : metadata) text += key + "=" + value + "\n";
+        std::uint32_t textBytes = text.size();
+        std::uint32_t headerBytes = (8 + 4*4 + textBytes + 7)/8*8;
+        std::vector<char> header(headerBytes, '\0');
+        std::uint32_t fields[4] = {kEventVersion, headerBytes, kEventRecordBytes, textBytes};
+        std::memcpy(header.data(), kEventMagic, 8);
+        std::memcpy(header.data() + 8, fields, sizeof(fields));
+        std::memcpy(header.data() + 8 + sizeof(fields), text.data(), textBytes);
+        flush();
+        fwrite(header.data(), 1, header.size(), file);
+    }
+
+    void write(int g, double t) {
+        if (used + recordBytes > buffer.size()) flush();
+        char* out = buffer.data() + used;
+        if (binary) {
+            std::int32_t registry = g;
+            std::memcpy(out, &registry, 4);
+            std::memcpy(out + 4, &t, 8);
+            used += kEventRecordBytes;
+        } else if (recordsRegistry) {
+            used += std::min<std::size_t>(snprintf(out, recordBytes, "%s%i %.12f\n", prefix.c_str(), g, t), recordBytes - 1);
+        } else {
+            used += std::min<std::size_t>(snprintf(out, recordBytes, "%s%.12f\n", prefix.c_str(), t), recordBytes - 1);
+        }
+    }
+
+    void flush() {
+        if (used > 0) fwrite(buffer.data(), 1, used, file);
+        used = 0;
+        fflush(file);
+    }
+
+private:
+    // room for the registry and time of a text record after the prefix (the time caps keep
+    // times far below 1e30); a longer record is cut, never written past its slot
+    static constexpr std::size_t kMaxNumberBytes = 64;
+
+    FILE* file;
+    bool binary;
+    bool recordsRegistry;
+    std::string prefix;
+    std::size_t recordBytes;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+};
+
+// Owns the output file of a run: stdout when fileName is empty. A run resumed from a
+// checkpoint keeps the first keepBytes bytes of the file and writes after them.
+class OutputFile {
+public:
+    explicit OutputFile(const std::string& fileName, bool binary, long long keepBytes = -1) {
+        if (fileName.empty()) {
+            file = stdout;
+            return;
+        }
+        if (keepBytes >= 0) {
+            if (truncate(fileName.c_str(), keepBytes) != 0) throw std::runtime_error("cannot resume " + fileName);
+            file = fopen(fileName.c_str(), binary ? "r+b" : "r+");
+            if (file) fseeko(file, 0, SEEK_END);
+        } else {
+            file = fopen(fileName.c_str(), binary ? "wb" : "w");
+        }
+        if (!file) throw std::runtime_error("cannot open " + fileName);
+        owned = true;
+    }
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    ~OutputFile() {
+        if (owned) fclose(file);
+    }
+
+    FILE* get() const { return file; }
+
+private:
+    FILE* file = nullptr;
+    bool owned = false;
+};
@@ -0,0 +1,60 @@
+//WORK-STEALING POOL OF INDEPENDENT TASKS
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+
+// Runs task(k) for k = 0 .. n - 1 on threads workers. Worker i starts with the i-th
+// contiguous slice of the tasks and takes them in order from the front of its deque; a worker
+// whose deque is empty steals from the back of the others, so a slice of slow tasks (37C
+// registry times next to 55C zipping) is shared out instead of holding up the rest. Tasks do
+// not create tasks, so a worker that finds every deque empty is done.
+template <class Task>
+void runWorkStealing(std::size_t n, int threads, Task&& task) {
+    const int workers = int(std::max<std::size_t>(1, std::min<std::size_t>(n, std::max(threads, 1))));
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (int i = 0; i < workers; i++) {
+        queues.push_back(std::make_unique<Queue>());
+        for (std::size_t k = n*i/workers; k < n*(i + 1)/workers; k++) queues[i]->tasks.push_back(k);
+    }
+
+    auto worker = [&](int self) {
+        while (true) {
+            std::size_t k = n;
+            {
+                Queue& own = *queues[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    k = own.tasks.front();
+                    own.tasks.pop_front();
+                }
+            }
+            // the next workers first, so thieves spread over the victims
+            for (int i = 1; i < workers && k == n; i++) {
+                Queue& victim = *queues[(self + i) % workers];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    k = victim.tasks.back();
+                    victim.tasks.pop_back();
+                }
+            }
+            if (k == n) return;
+            task(k);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < workers; i++) pool.emplace_back(worker, i);
+    worker(0);
+    for (auto& thread : pool) thread.join();
+}
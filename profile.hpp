@@ -0,0 +1,145 @@
+//HOT-PATH PROFILE OF THE GILLESPIE LOOP
+
+#pragma once
+
+// Compiled with -DKDNA_PROFILE, Simulation::run counts its moves, nucleations, steps per
+// absorbing event, the total rate of each step and the visits to the fully zipped state in
+// per-thread counters, merged when each thread exits and printed on stderr at exit. Without it
+// every hook below is an empty inline function and the loop compiles as before.
+
+#ifdef KDNA_PROFILE
+
+#include <cstdio>
+#include <cmath>
+#include <array>
+#include <mutex>
+
+namespace profile {
+
+// Moves in the order of the Gillespie selection: fray left (kB1), fray right (kB2), zip left
+// (kFL), zip right (kFR)
+constexpr int kMoves = 4;
+// kTotal and steps per event are binned by binary exponent, which frexp reads for free
+constexpr int kRateBins = 64;
+constexpr int kStepBins = 64;
+
+struct Counters {
+    long steps = 0;
+    long nucleations = 0;
+    long renucleations = 0;  // nucleations after the first of an absorbing event
+    long events = 0;
+    long eventSteps = 0;  // steps of the recorded events
+    long fullyZipped = 0;  // moves into xL == lMin && xR == rMax
+    std::array<long, kMoves> moves{};
+    std::array<long, kRateBins> rates{};  // bin i: 2^(i - 1) <= kTotal < 2^i
+    std::array<long, kStepBins> eventStepBins{};  // bin i: 2^(i - 1) <= steps < 2^i
+
+    void merge(const Counters& other) {
+        steps += other.steps;
+        nucleations += other.nucleations;
+        renucleations += other.renucleations;
+        events += other.events;
+        eventSteps += other.eventSteps;
+        fullyZipped += other.fullyZipped;
+        for (int i = 0; i < kMoves; i++) moves[i] += other.moves[i];
+        for (int i = 0; i < kRateBins; i++) rates[i] += other.rates[i];
+        for (int i = 0; i < kStepBins; i++) eventStepBins[i] += other.eventStepBins[i];
+    }
+};
+
+inline int exponentBin(double x, int bins) {
+    int e;
+    std::frexp(x, &e);
+    return e < 0 ? 0 : (e >= bins ? bins - 1 : e);
+}
+
+// Counters of the whole process, printed when static objects are destroyed, after the
+// thread-local counters of every thread were merged
+class Report {
+public:
+    void merge(const Counters& counters) {
+        std::lock_guard<std::mutex> lock(mutex);
+        total.merge(counters);
+    }
+
+    ~Report() {
+        const Counters& c = total;
+        if (c.steps == 0) return;
+        long moves = c.moves[0] + c.moves[1] + c.moves[2] + c.moves[3];
+        fprintf(stderr, "# profile\n");
+        fprintf(stderr, "steps %li\n", c.steps);
+        fprintf(stderr, "nucleations %li\n", c.nucleations);
+        fprintf(stderr, "renucleations %li\n", c.renucleations);
+        fprintf(stderr, "events %li\n", c.events);
+        fprintf(stderr, "steps_per_event %.6g\n", c.events ? double(c.eventSteps)/c.events : 0.0);
+        fprintf(stderr, "fully_zipped_visits %li\n", c.fullyZipped);
+        const char* names[kMoves] = {"kB1", "kB2", "kFL", "kFR"};
+        fprintf(stderr, "# move count fraction\n");
+        for (int i = 0; i < kMoves; i++) {
+            fprintf(stderr, "%s %li %.6f\n", names[i], c.moves[i], moves ? double(c.moves[i])/moves : 0.0);
+        }
+        fprintf(stderr, "# kTotal lower upper count\n");
+        for (int i = 0; i < kRateBins; i++) {
+            if (c.rates[i]) fprintf(stderr, "kTotal %.6g %.6g %li\n", std::ldexp(1.0, i - 1), std::ldexp(1.0, i), c.rates[i]);
+        }
+        fprintf(stderr, "# steps_per_event lower upper count\n");
+        for (int i = 0; i < kStepBins; i++) {
+            if (c.eventStepBins[i]) fprintf(stderr, "steps %.0f %.0f %li\n", std::ldexp(1.0, i - 1), std::ldexp(1.0, i), c.eventStepBins[i]);
+        }
+    }
+
+private:
+    std::mutex mutex;
+    Counters total;
+};
+
+inline Report& report() {
+    static Report instance;
+    return instance;
+}
+
+// Counters of one thread, merged into the report when the thread exits
+struct ThreadCounters : Counters {
+    ThreadCounters() { report(); }
+    ~ThreadCounters() { report().merge(*this); }
+};
+
+inline Counters& local() {
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+inline void nucleation() {
+    local().steps++;
+    local().nucleations++;
+}
+
+inline void move(int m, double kTotal, bool fullyZipped) {
+    Counters& c = local();
+    c.steps++;
+    c.moves[m]++;
+    c.rates[exponentBin(kTotal, kRateBins)]++;
+    if (fullyZipped) c.fullyZipped++;
+}
+
+inline void event(long steps, long nucleations) {
+    Counters& c = local();
+    c.events++;
+    c.eventSteps += steps;
+    c.renucleations += nucleations > 0 ? nucleations - 1 : 0;
+    c.eventStepBins[exponentBin(double(steps), kStepBins)]++;
+}
+
+}  // namespace profile
+
+#else
+
+namespace profile {
+
+inline void nucleation() {}
+inline void move(int, double, bool) {}
+inline void event(long, long) {}
+
+}  // namespace profile
+
+#endif
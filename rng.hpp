@@ -0,0 +1,209 @@
+//RANDOM NUMBER GENERATORS
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <array>
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC11): each output block is a keyed
+// bijection of a 128-bit counter. The key holds the seed and the upper half of the counter holds
+// the stream id, so streams (seed, stream) never overlap for fewer than 2^64 blocks each.
+class Philox {
+public:
+    using result_type = std::uint32_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+    Philox(std::uint64_t seed, std::uint64_t stream)
+        : key{std::uint32_t(seed), std::uint32_t(seed >> 32)},
+          counter{0, 0, std::uint32_t(stream), std::uint32_t(stream >> 32)} {}
+
+    // Independent generator for lane (or sub-task) i of this stream: the top byte of the stream
+    // id is reserved for it, leaving 2^56 streams per seed
+    Philox substream(unsigned i) const {
+        Philox sub = *this;
+        sub.counter[3] ^= std::uint32_t(i + 1) << 24;
+        sub.counter[0] = sub.counter[1] = 0;
+        sub.index = 4;
+        return sub;
+    }
+
+    std::uint64_t next64() {
+        std::uint64_t a = (*this)(), b = (*this)();
+        return (a << 32) | b;
+    }
+
+    // Uniform double in [0, 1) with 53 random bits
+    double uniform() { return double(next64() >> 11)*0x1.0p-53; }
+
+    result_type operator()() {
+        if (index == 4) {
+            generate();
+            index = 0;
+        }
+        return output[index++];
+    }
+
+private:
+    static constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    static constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+    void generate() {
+        std::uint32_t x[4] = {counter[0], counter[1], counter[2], counter[3]};
+        std::uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            std::uint64_t p0 = std::uint64_t(M0)*x[0];
+            std::uint64_t p1 = std::uint64_t(M1)*x[2];
+            x[0] = std::uint32_t(p1 >> 32) ^ x[1] ^ k0;
+            x[1] = std::uint32_t(p1);
+            x[2] = std::uint32_t(p0 >> 32) ^ x[3] ^ k1;
+            x[3] = std::uint32_t(p0);
+            k0 += W0; k1 += W1;
+        }
+        for (int i = 0; i < 4; i++) output[i] = x[i];
+        // advance the lower 64 bits of the counter, the upper half is the stream id
+        if (++counter[0] == 0) counter[1]++;
+    }
+
+    std::uint32_t key[2];
+    std::uint32_t counter[4];
+    std::uint32_t output[4] = {0, 0, 0, 0};
+    int index = 4;
+};
+
+// SplitMix64 step, used to expand seeds into generator states
+inline std::uint64_t splitMix64(std::uint64_t& x) {
+    std::uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256++ (Blackman and Vigna 2019): about a nanosecond per 64-bit output with a 2^256 - 1
+// period. Stream (seed, stream) is seeded through SplitMix64: s[0], s[1] from the seed, s[2],
+// s[3] from the stream keyed by s[0], so distinct (seed, stream) pairs, in either order, get
+// distinct states but, unlike Philox, not provably non-overlapping sequences (an overlap needs
+// ~2^-190 bad luck per pair).
+class Xoshiro256pp {
+public:
+    using result_type = std::uint64_t;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~std::uint64_t(0); }
+
+    Xoshiro256pp(std::uint64_t seed, std::uint64_t stream) {
+        std::uint64_t x = seed;
+        s[0] = splitMix64(x);
+        s[1] = splitMix64(x);
+        std::uint64_t y = stream ^ s[0];
+        s[2] = splitMix64(y);
+        s[3] = splitMix64(y);
+    }
+
+    Xoshiro256pp substream(unsigned i) const {
+        std::uint64_t mix = s[0] ^ (std::uint64_t(i + 1) << 56);
+        return Xoshiro256pp(splitMix64(mix), s[1] ^ s[2] ^ s[3]);
+    }
+
+    result_type operator()() { return next64(); }
+
+    std::uint64_t next64() {
+        std::uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    double uniform() { return double(next64() >> 11)*0x1.0p-53; }
+
+private:
+    static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    std::uint64_t s[4];
+};
+
+// Ziggurat tables for the unit exponential (Marsaglia and Tsang 2000), 256 layers of equal area:
+// x[0] is the width of the base layer including the tail beyond x[1] = r, x[256] = 0
+struct ExponentialZiggurat {
+    static constexpr double r = 7.69711747013104972;
+    static constexpr double v = 3.949659822581572e-3;
+    std::array<double, 257> x;
+    std::array<double, 257> f;
+
+    ExponentialZiggurat() {
+        x[0] = v/std::exp(-r);
+        x[1] = r;
+        for (int i = 1; i < 255; i++) x[i + 1] = -std::log(v/x[i] + std::exp(-x[i]));
+        x[256] = 0.0;
+        for (int i = 0; i < 257; i++) f[i] = std::exp(-x[i]);
+    }
+};
+
+inline const ExponentialZiggurat& exponentialZiggurat() {
+    static const ExponentialZiggurat table;
+    return table;
+}
+
+// Unit exponential variate: one 64-bit draw and a compare in ~99% of calls, no log
+template <class Rng>
+double exponential(Rng& rng, const ExponentialZiggurat& z) {
+    while (true) {
+        std::uint64_t bits = rng.next64();
+        int i = int(bits & 0xFF);
+        double x = double(bits >> 11)*0x1.0p-53*z.x[i];
+        if (x < z.x[i + 1]) return x;
+        if (i == 0) return ExponentialZiggurat::r - std::log(1.0 - rng.uniform());
+        if (z.f[i + 1] + rng.uniform()*(z.f[i] - z.f[i + 1]) < std::exp(-x)) return x;
+    }
+}
+
+// Bulk generation: n uniforms in [0, 1) or n unit exponentials
+template <class Rng>
+void fillUniform(Rng& rng, double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) out[i] = rng.uniform();
+}
+
+template <class Rng>
+void fillExponential(Rng& rng, double* out, std::size_t n) {
+    const ExponentialZiggurat& z = exponentialZiggurat();
+    for (std::size_t i = 0; i < n; i++) out[i] = exponential(rng, z);
+}
+
+// Uniform and exponential variates handed out from buffers refilled in bulk, so the Gillespie
+// loop pays neither per-call distribution overhead nor a log per waiting time
+template <class Rng>
+class VariateBuffer {
+public:
+    static constexpr int kSize = 256;
+
+    explicit VariateBuffer(Rng& rng) : rng(rng) {}
+
+    double uniform() {
+        if (nextUniform == kSize) {
+            fillUniform(rng, uniforms, kSize);
+            nextUniform = 0;
+        }
+        return uniforms[nextUniform++];
+    }
+
+    double exponential() {
+        if (nextExponential == kSize) {
+            fillExponential(rng, exponentials, kSize);
+            nextExponential = 0;
+        }
+        return exponentials[nextExponential++];
+    }
+
+private:
+    Rng& rng;
+    double uniforms[kSize];
+    double exponentials[kSize];
+    int nextUniform = kSize;
+    int nextExponential = kSize;
+};
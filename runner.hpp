@@ -0,0 +1,87 @@
+//MULTI-THREADED ENSEMBLE RUNNER
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+#include "rng.hpp"
+
+struct Event {
+    int g;
+    double t;
+};
+
+// Simulate stopCondition absorbing events as blocks of Sim::blockEvents spread over threads.
+// Block b starts from fresh trajectories and draws from the Rng stream (seed, streamBase + b),
+// so its events do not depend on which thread simulates it; Sim::startBlock(b) tells the
+// simulation (its trajectory recorder) which block it runs. Events are passed to emit(g, t) in
+// block order, so a seed gives the same output for any thread count. A block that hits the time
+// cap ends the run like the single-stream loop does. Blocks before firstBlock are skipped (a run
+// resumed from a checkpoint) and progress(nextBlock) is called after each emitted block while
+// the run goes on; it returns true to end the run there (--precision). Returns the number of
+// emitted events.
+template <class Rng, class Sim, class Emit, class Progress>
+long runEnsemble(const Sim& prototype, long stopCondition, std::uint64_t seed, std::uint64_t streamBase,
+                 int threads, Emit&& emit, long firstBlock, Progress&& progress) {
+    const long blockEvents = Sim::blockEvents;
+    const long nBlocks = (stopCondition + blockEvents - 1)/blockEvents;
+    // blocks may finish at most this far ahead of the next one to emit
+    const long maxAhead = 4*std::max(threads, 1);
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    long nextBlock = firstBlock;
+    long nextEmit = firstBlock;
+    long stopBlock = nBlocks;
+    long emitted = 0;
+    std::map<long, std::pair<std::vector<Event>, bool>> pending;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [&] { return nextBlock >= stopBlock || nextBlock < nextEmit + maxAhead; });
+            if (nextBlock >= stopBlock) return;
+            long block = nextBlock++;
+            lock.unlock();
+
+            long events = std::min(blockEvents, stopCondition - block*blockEvents);
+            Sim simulation(prototype);
+            simulation.startBlock(block);
+            Rng mt(seed, streamBase + block);
+            std::vector<Event> records;
+            records.reserve(events);
+            long done = simulation.run(events, mt, [&records](int g, double t) { records.push_back({g, t}); });
+
+            lock.lock();
+            pending[block] = std::make_pair(std::move(records), done < events);
+            while (!pending.empty() && pending.begin()->first == nextEmit && nextEmit < stopBlock) {
+                auto& [blockRecords, capped] = pending.begin()->second;
+                for (auto& e : blockRecords) emit(e.g, e.t);
+                emitted += blockRecords.size();
+                if (capped) stopBlock = nextEmit + 1;
+                pending.erase(pending.begin());
+                nextEmit++;
+                if (nextEmit < stopBlock && progress(nextEmit)) stopBlock = nextEmit;
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+    return emitted;
+}
+
+template <class Rng, class Sim, class Emit>
+long runEnsemble(const Sim& prototype, long stopCondition, std::uint64_t seed, std::uint64_t streamBase,
+                 int threads, Emit&& emit) {
+    return runEnsemble<Rng>(prototype, stopCondition, seed, streamBase, threads, emit, 0, [](long) { return false; });
+}
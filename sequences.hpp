@@ -0,0 +1,52 @@
+//SEQUENCE LIBRARIES
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+struct SequenceRecord {
+    std::string id;
+    std::string seq;
+};
+
+// Reads a FASTA file (">id description" headers, sequence split over any number of lines) or a
+// plain list with one "seq" or "id seq" per line, numbered from 1 when no id is given; '#'
+// starts a comment in plain lists
+inline std::vector<SequenceRecord> readSequences(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file) throw std::runtime_error("cannot open " + fileName);
+    std::vector<SequenceRecord> records;
+    std::string line;
+    bool fasta = false;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty() && line[0] == '>') {
+            fasta = true;
+            std::istringstream header(line.substr(1));
+            SequenceRecord record;
+            header >> record.id;
+            if (record.id.empty()) record.id = std::to_string(records.size() + 1);
+            records.push_back(record);
+            continue;
+        }
+        std::istringstream fields(fasta ? line : line.substr(0, line.find('#')));
+        if (fasta) {
+            if (records.empty()) throw std::runtime_error("sequence before the first FASTA header in " + fileName);
+            for (std::string part; fields >> part;) records.back().seq += part;
+            continue;
+        }
+        std::string first, second;
+        if (!(fields >> first)) continue;
+        if (fields >> second) records.push_back({first, second});
+        else records.push_back({std::to_string(records.size() + 1), first});
+    }
+    for (auto& record : records) {
+        if (record.seq.empty() || record.seq.find_first_not_of("ACGTacgt") != std::string::npos)
+            throw std::runtime_error("bad sequence " + record.id + ": " + record.seq);
+    }
+    return records;
+}
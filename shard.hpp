@@ -0,0 +1,171 @@
+//SHARDED RUNS AND THE MERGE OF THEIR PARTIAL SUMMARIES
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdexcept>
+
+#include "checkpoint.hpp"
+#include "stats.hpp"
+
+// Partial summary files of --shard: a header, then length-prefixed records
+//
+//   char[8]  magic "KDNASHD\0"
+//   uint32   version (1)
+//   uint32   0
+//   uint64   record bytes, then the record, for every record
+//
+// The first record names the shard (ShardHeader), every other record holds the SummaryCollector
+// of one run (temperature) of the command with the title of its report.
+constexpr char kShardMagic[8] = {'K', 'D', 'N', 'A', 'S', 'H', 'D', '\0'};
+constexpr std::uint32_t kShardVersion = 1;
+
+// Shard index of count shards of a command: the options the events depend on (key) and the seed
+struct ShardHeader {
+    std::string key;
+    std::string seed;
+    std::uint64_t index = 0;
+    std::uint64_t count = 1;
+};
+
+// Blocks [first, last) of nBlocks taken by shard index of count: contiguous ranges in shard
+// order, so the shards run exactly the blocks, and RNG streams, of the whole run
+inline std::pair<long, long> shardBlocks(long nBlocks, long index, long count) {
+    return {nBlocks*index/count, nBlocks*(index + 1)/count};
+}
+
+// Parses "i/N" with 0 <= i < N
+inline ShardHeader parseShard(const std::string& text) {
+    ShardHeader shard;
+    std::size_t slash = text.find('/');
+    try {
+        if (slash == std::string::npos) throw std::invalid_argument(text);
+        shard.index = std::stoull(text.substr(0, slash));
+        shard.count = std::stoull(text.substr(slash + 1));
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("--shard must be i/N");
+    }
+    if (shard.count == 0 || shard.index >= shard.count) throw std::runtime_error("--shard i/N needs 0 <= i < N");
+    return shard;
+}
+
+inline void writeShardRecord(FILE* file, const std::string& bytes) {
+    std::uint64_t size = bytes.size();
+    if (fwrite(&size, 8, 1, file) != 1 || fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+        throw std::runtime_error("cannot write the shard summary");
+}
+
+inline void writeShardHeader(FILE* file, const ShardHeader& shard) {
+    std::uint32_t fields[2] = {kShardVersion, 0};
+    fwrite(kShardMagic, 1, 8, file);
+    fwrite(fields, sizeof(fields), 1, file);
+    ByteWriter out;
+    out.putString(shard.key);
+    out.putString(shard.seed);
+    out.put(shard.index);
+    out.put(shard.count);
+    writeShardRecord(file, out.bytes);
+}
+
+// Summary of one run of a shard, in place of its --summary report
+inline void writeShardRun(FILE* file, const std::string& title, bool perRegistry, const SummaryCollector& summary) {
+    ByteWriter out;
+    out.putString(title);
+    out.put(std::uint8_t(perRegistry));
+    summary.save(out);
+    writeShardRecord(file, out.bytes);
+    fflush(file);
+}
+
+struct ShardRun {
+    std::string title;
+    bool perRegistry = false;
+    SummaryCollector summary{false};
+};
+
+struct ShardFile {
+    ShardHeader header;
+    std::vector<ShardRun> runs;
+};
+
+inline ShardFile readShardFile(const std::string& fileName) {
+    FILE* file = fopen(fileName.c_str(), "rb");
+    if (!file) throw std::runtime_error("cannot open " + fileName);
+    ShardFile shard;
+    try {
+        char magic[8];
+        std::uint32_t fields[2];
+        if (fread(magic, 1, 8, file) != 8 || std::memcmp(magic, kShardMagic, 8) != 0 || fread(fields, sizeof(fields), 1, file) != 1 ||
+            fields[0] != kShardVersion)
+            throw std::runtime_error("");
+        bool first = true;
+        for (std::uint64_t size; fread(&size, 8, 1, file) == 1;) {
+            std::string bytes(size, '\0');
+            if (fread(&bytes[0], 1, size, file) != size) throw std::runtime_error("");
+            ByteReader in(bytes);
+            if (first) {
+                in.getString(shard.header.key);
+                in.getString(shard.header.seed);
+                in.get(shard.header.index);
+                in.get(shard.header.count);
+                first = false;
+                continue;
+            }
+            std::string title;
+            std::uint8_t perRegistry = 0;
+            in.getString(title);
+            in.get(perRegistry);
+            shard.runs.push_back({title, perRegistry != 0, SummaryCollector(perRegistry != 0)});
+            shard.runs.back().summary.load(in);
+        }
+        if (first) throw std::runtime_error("");
+    } catch (const std::runtime_error&) {
+        fclose(file);
+        throw std::runtime_error("corrupt shard summary " + fileName);
+    }
+    fclose(file);
+    if (shard.header.count == 0 || shard.header.index >= shard.header.count)
+        throw std::runtime_error(fileName + " is shard " + std::to_string(shard.header.index) + "/" + std::to_string(shard.header.count) +
+                                 ", shards i/N need 0 <= i < N");
+    return shard;
+}
+
+// Merges the shard files of one command, given in any order: every shard i/N must be there once,
+// with the same options and seed and all its runs. The summaries are merged in shard order, so
+// counts, histograms and quantiles are those of the whole run and the moments agree with it to
+// rounding; reports are written to file as the whole run would have written them.
+inline void mergeShards(const std::vector<std::string>& fileNames, FILE* file) {
+    if (fileNames.empty()) throw std::runtime_error("merge needs shard summary files");
+    std::vector<ShardFile> shards;
+    for (auto& name : fileNames) shards.push_back(readShardFile(name));
+    const ShardHeader& first = shards[0].header;
+    std::map<std::uint64_t, const ShardFile*> ordered;
+    for (std::size_t i = 0; i < shards.size(); i++) {
+        const ShardHeader& h = shards[i].header;
+        if (h.key != first.key || h.seed != first.seed || h.count != first.count)
+            throw std::runtime_error(fileNames[i] + " is a shard of another command than " + fileNames[0]);
+        if (!ordered.emplace(h.index, &shards[i]).second) throw std::runtime_error(fileNames[i] + " repeats shard " + std::to_string(h.index));
+        if (shards[i].runs.size() != shards[0].runs.size()) throw std::runtime_error(fileNames[i] + " is incomplete");
+    }
+    // indices are below count (readShardFile), so count distinct ones are all of 0..count - 1
+    if (ordered.size() != first.count) {
+        std::uint64_t missing = 0;
+        for (auto& entry : ordered) {
+            if (entry.first != missing) break;
+            missing++;
+        }
+        throw std::runtime_error("shard " + std::to_string(missing) + "/" + std::to_string(first.count) + " is missing");
+    }
+
+    for (std::size_t r = 0; r < shards[0].runs.size(); r++) {
+        SummaryCollector merged(shards[0].runs[r].perRegistry);
+        for (auto& [index, shard] : ordered) merged.merge(shard->runs[r].summary);
+        merged.writeReport(file, shards[0].runs[r].title);
+    }
+    fflush(file);
+}
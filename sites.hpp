@@ -0,0 +1,61 @@
+//PER-SITE ZIPPING OUTCOMES OF THE IN-REGISTRY NUCLEUS
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+
+#include "engine.hpp"
+#include "rng.hpp"
+#include "pool.hpp"
+#include "stats.hpp"
+
+// Outcomes of the attempts nucleated at one site: an attempt is the nucleation wait plus the
+// moves until the nucleus zips fully or melts, the time of each outcome kept as running moments
+struct SiteCounters {
+    RunningMoments zipped;
+    RunningMoments melted;
+
+    long attempts() const { return zipped.count + melted.count; }
+    double success() const { return attempts() ? double(zipped.count)/attempts() : 0.0; }
+
+    // Mean successful zipping time of nuclei formed only at this site: a geometric number of
+    // attempts, so by Wald's identity the mean attempt time over the success probability
+    double successfulTime() const {
+        if (zipped.count == 0) return std::numeric_limits<double>::infinity();
+        return (zipped.mean*zipped.count + melted.mean*melted.count)/zipped.count;
+    }
+};
+
+// Simulates attempts attempts at every site x in [x1, x2] of the in-registry chain with the moves
+// of Simulation::run (gillespieMove) and nucleation waits Exp(kNucleation). Sites are spread over
+// the work-stealing pool, site x drawing from the stream (seed, streamBase + x), so the counters
+// do not depend on the number of threads; counters[x - x1] holds site x.
+template <class Rng>
+std::vector<SiteCounters> sampleSites(const RateTable& rates, int x1, int x2, long attempts, double kNucleation,
+                                      std::uint64_t seed, std::uint64_t streamBase, int threads) {
+    std::vector<SiteCounters> counters(std::max(0, x2 - x1 + 1));
+    runWorkStealing(counters.size(), threads, [&](std::size_t k) {
+        const int x = x1 + int(k);
+        Rng mt(seed, streamBase + x);
+        VariateBuffer<Rng> variates(mt);
+        SiteCounters& site = counters[k];
+        for (long a = 0; a < attempts; a++) {
+            State s;
+            s.xL = s.xR = s.yL = s.yR = x;
+            s.hBonds = 1;
+            s.full = rates.len;
+            s.t = variates.exponential()/kNucleation;
+            double kTotal;
+            while (s.hBonds != 0 && s.hBonds != s.full) {
+                gillespieMove(s, rates, variates.uniform(), kTotal);
+                s.t += variates.exponential()/kTotal;
+            }
+            if (s.hBonds == 0) site.melted.add(s.t);
+            else site.zipped.add(s.t);
+        }
+    });
+    return counters;
+}
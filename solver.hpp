@@ -0,0 +1,425 @@
+//EXACT FIRST-PASSAGE TIMES OF THE ZIPPING CHAIN
+
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+#include "engine.hpp"
+
+// Square matrix with `lower` subdiagonals and `upper` superdiagonals, factorized in place by
+// Gaussian elimination without pivoting (the chain matrices are diagonally dominant M-matrices)
+class BandedMatrix {
+public:
+    BandedMatrix(int n, int lower, int upper)
+        : n(n), lower(lower), upper(upper), width(lower + upper + 1), band(std::size_t(n)*width, 0.0) {}
+
+    double& at(int i, int j) { return band[std::size_t(i)*width + (j - i + lower)]; }
+
+    void factorize() {
+        for (int k = 0; k < n; k++) {
+            double pivot = at(k, k);
+            int last = std::min(n - 1, k + lower);
+            int lastColumn = std::min(n - 1, k + upper);
+            for (int i = k + 1; i <= last; i++) {
+                double& factor = at(i, k);
+                if (factor == 0.0) continue;
+                factor /= pivot;
+                for (int j = k + 1; j <= lastColumn; j++) at(i, j) -= factor*at(k, j);
+            }
+        }
+    }
+
+    // Solve A x = b with the factorized matrix, b is overwritten by x
+    void solve(std::vector<double>& b) {
+        for (int i = 0; i < n; i++) {
+            for (int j = std::max(0, i - lower); j < i; j++) b[i] -= at(i, j)*b[j];
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            for (int j = i + 1; j <= std::min(n - 1, i + upper); j++) b[i] -= at(i, j)*b[j];
+            b[i] /= at(i, i);
+        }
+    }
+
+private:
+    int n, lower, upper, width;
+    std::vector<double> band;
+};
+
+// Moves out of (xL, xR) in registry row with the rates of Simulation::run, as f(toL, toR, k);
+// a duplex that melts moves to toL > toR
+template <class F>
+void forEachMove(const RateTable& rates, int row, int xL, int xR, F&& f) {
+    const int g = row - rates.len + 1;
+    double kB1 = rates.kBreak(xL, xL + g);
+    double kB2 = rates.kBreak(xR, xR + g);
+    if (kB1 != 0.0) f(xL + 1, xR, kB1);
+    if (xR != xL && kB2 != 0.0) f(xL, xR - 1, kB2);
+    if (xL != rates.lMinRow[row]) f(xL - 1, xR, rates.kForm);
+    if (xR != rates.rMaxRow[row]) f(xL, xR + 1, rates.kForm);
+}
+
+// Averages over the nucleation sites of one registry: probability that the nucleus zips to
+// the full duplex of the registry, mean duration of an attempt from nucleation to absorption (nucleation
+// wait excluded) and mean of duration times the failure indicator
+struct RegistrySolution {
+    int g = 0;
+    double weight = 0.0;
+    double success = 0.0;
+    double duration = 0.0;
+    double failedDuration = 0.0;
+};
+
+// Solution of the chain over (xL, xR) of one registry at every state lMin <= xL <= xR <= rMax,
+// numbered row by row in xL (n = rMax - lMin + 1 states in the first row, one fewer in each
+// next): the mean duration until absorption, the probability of zipping fully (the committor)
+// and the mean duration times the failure indicator
+struct ChainSolution {
+    int lMin = 0, rMax = 0, n = 0;
+    std::vector<double> time;
+    std::vector<double> zipped;
+    std::vector<double> failed;
+
+    static long states(int n) { return long(n)*(n + 1)/2; }
+    int index(int xL, int xR) const {
+        long row = xL - lMin;
+        return int(row*n - row*(row - 1)/2 + (xR - xL));
+    }
+};
+
+// Largest band of the chain matrix solveChain factorizes: the band holds n (n + 1)/2 rows of
+// 2n + 1 entries, 8 n^3 bytes, so this allows registries of up to ~400 pairs
+constexpr double kMaxChainBytes = 512.0*1024*1024;
+
+// Solve the chain over (xL, xR) of registry g, the same moves and rates as Simulation::run,
+// absorbed when the duplex melts and, if zipAbsorbs, when it is fully zipped (lMin..rMax),
+// where the zipping probability is 1
+inline ChainSolution solveChain(const RateTable& rates, int g, bool zipAbsorbs) {
+    const int row = g + rates.len - 1;
+    ChainSolution chain;
+    const int lMin = chain.lMin = rates.lMinRow[row];
+    const int rMax = chain.rMax = rates.rMaxRow[row];
+    const int n = chain.n = rMax - lMin + 1;
+    const long states = ChainSolution::states(n);
+    double bytes = 8.0*states*(2*n + 1);
+    if (bytes > kMaxChainBytes) {
+        throw std::runtime_error("the chain of registry " + std::to_string(g) + " (" + std::to_string(n) + " pairs) needs " +
+                                 std::to_string(long(bytes/(1024*1024))) + " MB, beyond the " + std::to_string(long(kMaxChainBytes/(1024*1024))) +
+                                 " MB of the exact solver; use --method gillespie");
+    }
+    // moves shift the unknown by 1 or by the length of a row, at most n
+    auto index = [&](int xL, int xR) { return chain.index(xL, xR); };
+    auto absorbing = [&](int xL, int xR) { return zipAbsorbs && xL == lMin && xR == rMax; };
+
+    BandedMatrix a(states, n, n);
+    std::vector<double>& time = chain.time;
+    std::vector<double>& zipped = chain.zipped;
+    std::vector<double> leave(states, 0.0);
+    time.assign(states, 0.0);
+    zipped.assign(states, 0.0);
+    for (int xL = lMin; xL <= rMax; xL++) {
+        for (int xR = xL; xR <= rMax; xR++) {
+            int i = index(xL, xR);
+            a.at(i, i) = 1.0;
+            if (absorbing(xL, xR)) continue;
+            double kTotal = 0.0;
+            forEachMove(rates, row, xL, xR, [&](int, int, double k) { kTotal += k; });
+            leave[i] = 1.0/kTotal;
+            time[i] = 1.0/kTotal;
+            // each move to a transient state couples the unknowns, moves into an absorbing
+            // zipped state feed the success probability, melting feeds neither
+            forEachMove(rates, row, xL, xR, [&](int toL, int toR, double k) {
+                if (toL > toR) return;
+                if (absorbing(toL, toR)) zipped[i] += k/kTotal;
+                else a.at(i, index(toL, toR)) -= k/kTotal;
+            });
+        }
+    }
+    a.factorize();
+    a.solve(time);
+    a.solve(zipped);
+    // E[D 1fail] solves the same system with the holding time weighted by P(fail)
+    std::vector<double>& failed = chain.failed;
+    failed.assign(states, 0.0);
+    for (long i = 0; i < states; i++) failed[i] = leave[i]*(1.0 - zipped[i]);
+    a.solve(failed);
+    if (zipAbsorbs) {
+        int i = index(lMin, rMax);
+        zipped[i] = 1.0;
+        time[i] = failed[i] = 0.0;
+    }
+    return chain;
+}
+
+// Averages of solveChain over the nucleation sites x in [x1, x2] (within the registry bounds),
+// which are equally likely
+inline RegistrySolution solveRegistry(const RateTable& rates, int g, int x1, int x2, bool zipAbsorbs) {
+    ChainSolution chain = solveChain(rates, g, zipAbsorbs);
+    RegistrySolution solution;
+    solution.g = g;
+    int sites = 0;
+    for (int x = std::max(x1, chain.lMin); x <= std::min(x2, chain.rMax); x++) {
+        int i = chain.index(x, x);
+        solution.success += chain.zipped[i];
+        solution.duration += chain.time[i];
+        solution.failedDuration += chain.failed[i];
+        sites++;
+    }
+    if (sites > 0) {
+        solution.success /= sites;
+        solution.duration /= sites;
+        solution.failedDuration /= sites;
+    }
+    return solution;
+}
+
+// Registry time: every registry g != 0 with its nucleation probability, nuclei x != y being
+// uniform over [1, len]^2; the mean registry time of g is the nucleation wait plus the duration
+inline std::vector<RegistrySolution> solveRegistryTimes(const RateTable& rates) {
+    const int len = rates.len;
+    std::vector<RegistrySolution> solutions;
+    for (int g = 1 - len; g < len; g++) {
+        if (g == 0) continue;
+        RegistrySolution s = solveRegistry(rates, g, 1, len, false);
+        s.weight = double(len - std::abs(g))/(double(len)*len - len);
+        solutions.push_back(s);
+    }
+    return solutions;
+}
+
+// Mean nucleation wait, Exp(len^2 kForm) as in Simulation::run
+inline double meanNucleationTime(const RateTable& rates) {
+    return 1.0/(double(rates.len)*rates.len*rates.kForm);
+}
+
+// Successful zipping time: a geometric number of attempts (success probability p), each a
+// nucleation wait plus a duration, so by Wald's identity (E[tau_n] + E[D])/p
+inline double successfulTime(const RateTable& rates, const RegistrySolution& s) {
+    if (s.success == 0.0) return std::numeric_limits<double>::infinity();
+    return (meanNucleationTime(rates) + s.duration)/s.success;
+}
+
+// Failed zipping time: the nucleation wait plus the duration of an attempt given it fails
+inline double failedTime(const RateTable& rates, const RegistrySolution& s) {
+    if (s.success == 1.0) return std::nan("");
+    return meanNucleationTime(rates) + s.failedDuration/(1.0 - s.success);
+}
+
+// First-passage time whose distribution passageDistribution computes: the melting of a
+// registry (registry time), zipping with renucleation after every failure (successful zipping
+// time), or melting given that the attempt fails (failed zipping time)
+enum class Passage { Melting, Zipping, FailedZipping };
+
+struct PassageDistribution {
+    std::vector<double> cdf;
+    std::vector<double> pdf;
+};
+
+// Tails of the Poisson(x) distribution for k = 0..n: cdf[k] = P(N >= k), the CDF of an
+// Erlang(k) time, and pmf[k] = P(N = k - 1), its density divided by the rate
+inline void erlangTerms(double x, long n, std::vector<double>& cdf, std::vector<double>& pmf) {
+    cdf.assign(n + 1, 0.0);
+    pmf.assign(n + 1, 0.0);
+    // terms beyond 40 standard deviations underflow
+    long lo = std::max(0L, long(std::floor(x - 40.0*std::sqrt(x) - 40.0)));
+    long hi = long(std::ceil(x + 40.0*std::sqrt(x) + 40.0));
+    double tail = 0.0;
+    for (long j = hi; j >= lo; j--) {
+        double pj = (j == 0) ? std::exp(-x) : std::exp(-x + j*std::log(x) - std::lgamma(j + 1.0));
+        tail += pj;
+        if (j <= n) cdf[j] = tail;
+        if (j + 1 <= n) pmf[j + 1] = pj;
+    }
+    for (long j = std::min(lo - 1, n); j >= 0; j--) cdf[j] = tail;
+}
+
+// CDF and PDF of a first-passage time of registry g (nucleation sites [x1, x2]) at the given
+// times, nucleation waits included, without sampling. The chain over (xL, xR) is uniformized
+// at rate L (the fastest state), so after k jumps and m nucleations the elapsed time is
+// Erlang(k, L) + Erlang(m, kN) with kN = len^2 kForm. The discrete chain gives the probability
+// q[m][k] of absorbing at that point, and with c = kN/(kN - L) the Laplace transforms satisfy
+// A^k B^m = c A^k B^(m-1) - (c - 1) A^(k-1) B^m, a recursion that is stable for kN > 2L.
+// When nucleation is slower (short sequences, small kForm), the wait for a nucleus becomes one
+// more state and the whole passage is uniformized at max(L, kN), at most 2L, instead.
+// Steps run until the chain is empty or the last time is resolved.
+inline PassageDistribution passageDistribution(const RateTable& rates, int g, int x1, int x2, Passage passage,
+                                               const std::vector<double>& times) {
+    const int row = g + rates.len - 1;
+    const int lMin = rates.lMinRow[row];
+    const int rMax = rates.rMaxRow[row];
+    const int n = rMax - lMin + 1;
+    const bool zipAbsorbs = passage != Passage::Melting;
+    const double kNucleation = 1.0/meanNucleationTime(rates);
+
+    // transient states, numbered in (xL, xR) order
+    std::vector<int> number(n*n, -1);
+    int states = 0;
+    for (int xL = lMin; xL <= rMax; xL++) {
+        for (int xR = xL; xR <= rMax; xR++) {
+            if (!(zipAbsorbs && xL == lMin && xR == rMax)) number[(xL - lMin)*n + (xR - lMin)] = states++;
+        }
+    }
+    double uniform = 0.0;
+    for (int xL = lMin; xL <= rMax; xL++) {
+        for (int xR = xL; xR <= rMax; xR++) {
+            if (number[(xL - lMin)*n + (xR - lMin)] < 0) continue;
+            double total = 0.0;
+            forEachMove(rates, row, xL, xR, [&](int, int, double k) { total += k; });
+            uniform = std::max(uniform, total);
+        }
+    }
+    const bool slowNucleation = kNucleation <= 2.0*uniform;
+    if (slowNucleation) uniform = std::max(uniform, kNucleation);
+
+    // one jump of the uniformized chain: the probability to stay, the jumps into each state as
+    // compressed rows of (source, probability), and the probabilities to melt or zip
+    std::vector<double> stay(states, 1.0), melt(states, 0.0), zip(states, 0.0);
+    std::vector<std::vector<std::pair<int, double>>> incoming(states);
+    for (int xL = lMin; xL <= rMax; xL++) {
+        for (int xR = xL; xR <= rMax; xR++) {
+            int i = number[(xL - lMin)*n + (xR - lMin)];
+            if (i < 0) continue;
+            forEachMove(rates, row, xL, xR, [&](int toL, int toR, double k) {
+                stay[i] -= k/uniform;
+                if (toL > toR) melt[i] += k/uniform;
+                else if (number[(toL - lMin)*n + (toR - lMin)] < 0) zip[i] += k/uniform;
+                else incoming[number[(toL - lMin)*n + (toR - lMin)]].emplace_back(i, k/uniform);
+            });
+        }
+    }
+    std::vector<int> start(1, 0), from;
+    std::vector<double> probability;
+    for (auto& in : incoming) {
+        for (auto& [i, prob] : in) {
+            from.push_back(i);
+            probability.push_back(prob);
+        }
+        start.push_back(from.size());
+    }
+
+    std::vector<double> sites(states, 0.0);
+    int nSites = 0;
+    for (int x = std::max(x1, lMin); x <= std::min(x2, rMax); x++) nSites++;
+    for (int x = std::max(x1, lMin); x <= std::min(x2, rMax); x++) sites[number[(x - lMin)*n + (x - lMin)]] = 1.0/nSites;
+
+    double tMax = *std::max_element(times.begin(), times.end());
+    double jumps = uniform*tMax;
+    const long kMax = long(std::ceil(jumps + 12.0*std::sqrt(jumps) + 50.0));
+    // failed times are conditioned on failing
+    double scale = 1.0;
+    if (passage == Passage::FailedZipping) scale = 1.0/(1.0 - solveRegistry(rates, g, x1, x2, true).success);
+
+    if (slowNucleation) {
+        // jumps of the whole passage: waiting is the mass without a nucleus, absorbed[k] the
+        // probability of absorbing at jump k
+        std::vector<double> p(states, 0.0), next(states), absorbed(1, 0.0);
+        double waiting = 1.0;
+        const double nucleate = kNucleation/uniform;
+        long kLast = 0;
+        for (long k = 1; k <= kMax; k++) {
+            double zipped = 0.0, melted = 0.0, remaining = 0.0;
+            for (int i = 0; i < states; i++) {
+                double mass = p[i]*stay[i] + waiting*nucleate*sites[i];
+                for (int e = start[i]; e < start[i + 1]; e++) mass += p[from[e]]*probability[e];
+                next[i] = mass;
+                melted += p[i]*melt[i];
+                zipped += p[i]*zip[i];
+                remaining += mass;
+            }
+            p.swap(next);
+            waiting *= 1.0 - nucleate;
+            // melted attempts renucleate when zipping is the target
+            if (passage == Passage::Zipping) waiting += melted;
+            remaining += waiting;
+            absorbed.push_back((passage == Passage::Zipping) ? zipped : melted);
+            kLast = k;
+            if (remaining < 1e-15) break;
+        }
+        PassageDistribution result;
+        std::vector<double> jumpCdf, jumpPmf;
+        for (double t : times) {
+            erlangTerms(uniform*t, kLast, jumpCdf, jumpPmf);
+            double cdf = 0.0, pdf = 0.0;
+            for (long k = 1; k <= kLast; k++) {
+                cdf += absorbed[k]*jumpCdf[k];
+                pdf += absorbed[k]*uniform*jumpPmf[k];
+            }
+            result.cdf.push_back(scale*cdf);
+            result.pdf.push_back(scale*pdf);
+        }
+        return result;
+    }
+
+    // jumps of the uniformized chain: q[m][k] is the probability of absorbing at jump k
+    // during attempt m + 1
+    std::vector<std::vector<double>> p(1, sites), q(1, std::vector<double>(1, 0.0));
+    std::vector<double> next(states);
+    long kLast = 0;
+    for (long k = 1; k <= kMax; k++) {
+        double remaining = 0.0;
+        std::vector<double> melted(p.size(), 0.0);
+        for (std::size_t m = 0; m < p.size(); m++) {
+            const double* current = p[m].data();
+            double zipped = 0.0;
+            for (int i = 0; i < states; i++) {
+                double mass = current[i]*stay[i];
+                for (int e = start[i]; e < start[i + 1]; e++) mass += current[from[e]]*probability[e];
+                next[i] = mass;
+                melted[m] += current[i]*melt[i];
+                zipped += current[i]*zip[i];
+                remaining += mass;
+            }
+            p[m].swap(next);
+            q[m].push_back((passage == Passage::Zipping) ? zipped : melted[m]);
+        }
+        // melted attempts renucleate when zipping is the target
+        if (passage == Passage::Zipping) {
+            for (std::size_t m = 0; m < melted.size(); m++) {
+                if (melted[m] < 1e-17) continue;
+                if (m + 1 == p.size()) {
+                    p.emplace_back(states, 0.0);
+                    q.emplace_back(k + 1, 0.0);
+                }
+                for (int i = 0; i < states; i++) p[m + 1][i] += melted[m]*sites[i];
+                remaining += melted[m];
+            }
+        }
+        kLast = k;
+        if (remaining < 1e-15) break;
+    }
+
+    for (auto& absorbed : q) absorbed.resize(kLast + 1, 0.0);
+    const int attempts = p.size();
+    const double c = kNucleation/(kNucleation - uniform);
+    PassageDistribution result;
+    std::vector<double> jumpCdf, jumpPmf, nucleationCdf, nucleationPmf;
+    std::vector<double> prevCdf(kLast + 1), prevPdf(kLast + 1), curCdf(kLast + 1), curPdf(kLast + 1);
+    for (double t : times) {
+        erlangTerms(uniform*t, kLast, jumpCdf, jumpPmf);
+        erlangTerms(kNucleation*t, attempts, nucleationCdf, nucleationPmf);
+        for (long k = 0; k <= kLast; k++) {
+            prevCdf[k] = jumpCdf[k];
+            prevPdf[k] = uniform*jumpPmf[k];
+        }
+        double cdf = 0.0, pdf = 0.0;
+        for (int m = 1; m <= attempts; m++) {
+            curCdf[0] = nucleationCdf[m];
+            curPdf[0] = kNucleation*nucleationPmf[m];
+            for (long k = 1; k <= kLast; k++) {
+                curCdf[k] = c*prevCdf[k] - (c - 1.0)*curCdf[k - 1];
+                curPdf[k] = c*prevPdf[k] - (c - 1.0)*curPdf[k - 1];
+                cdf += q[m - 1][k]*curCdf[k];
+                pdf += q[m - 1][k]*curPdf[k];
+            }
+            prevCdf.swap(curCdf);
+            prevPdf.swap(curPdf);
+        }
+        result.cdf.push_back(scale*cdf);
+        result.pdf.push_back(scale*pdf);
+    }
+    return result;
+}
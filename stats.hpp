@@ -0,0 +1,340 @@
+//STREAMING STATISTICS OF ABSORBING EVENTS
+
+#pragma once
+
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <array>
+#include <string>
+#include <limits>
+#include <algorithm>
+
+// Count, mean and variance updated one value at a time (Welford), merged with Chan's formula
+struct RunningMoments {
+    long count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+
+    void add(double x) {
+        count++;
+        double delta = x - mean;
+        mean += delta/count;
+        m2 += delta*(x - mean);
+        min = std::min(min, x);
+        max = std::max(max, x);
+    }
+
+    void merge(const RunningMoments& other) {
+        if (other.count == 0) return;
+        long n = count + other.count;
+        double delta = other.mean - mean;
+        mean += delta*other.count/n;
+        m2 += other.m2 + delta*delta*double(count)*other.count/n;
+        count = n;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    double variance() const { return count > 1 ? m2/(count - 1) : 0.0; }
+
+    template <class Writer>
+    void save(Writer& out) const {
+        out.put(count); out.put(mean); out.put(m2); out.put(min); out.put(max);
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        in.get(count); in.get(mean); in.get(m2); in.get(min); in.get(max);
+    }
+};
+
+// Histogram with kPerDecade bins per decade of time from 10^kMinExponent to 10^kMaxExponent,
+// plus an underflow bin 0 and an overflow bin kBins - 1
+struct LogHistogram {
+    static constexpr int kMinExponent = -15;
+    static constexpr int kMaxExponent = 8;
+    static constexpr int kPerDecade = 10;
+    static constexpr int kBins = (kMaxExponent - kMinExponent)*kPerDecade + 2;
+    std::array<long, kBins> counts{};
+
+    static int bin(double x) {
+        if (!(x >= lower(1))) return 0;
+        int i = 1 + int(std::floor((std::log10(x) - kMinExponent)*kPerDecade));
+        return std::min(i, kBins - 1);
+    }
+
+    // lower edge of bin i >= 1
+    static double lower(int i) { return std::pow(10.0, kMinExponent + double(i - 1)/kPerDecade); }
+
+    void add(double x) { counts[bin(x)]++; }
+
+    void merge(const LogHistogram& other) {
+        for (int i = 0; i < kBins; i++) counts[i] += other.counts[i];
+    }
+
+    template <class Writer>
+    void save(Writer& out) const {
+        for (long c : counts) out.put(c);
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        for (long& c : counts) in.get(c);
+    }
+};
+
+// Quantile sketch with relative accuracy alpha (DDSketch, Masson et al. 2019): x > 0 lands in
+// bucket ceil(log_gamma x), gamma = (1 + alpha)/(1 - alpha), so any quantile is returned within
+// a factor 1 +- alpha of the exact order statistic. Sketches merge by adding buckets.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(double alpha = 0.005)
+        : gamma((1.0 + alpha)/(1.0 - alpha)), logGamma(std::log(gamma)) {}
+
+    void add(double x) {
+        if (!(x > 0.0)) {
+            zeros++;
+            return;
+        }
+        int index = int(std::ceil(std::log(x)/logGamma));
+        grow(index);
+        buckets[index - offset]++;
+    }
+
+    void merge(const QuantileSketch& other) {
+        zeros += other.zeros;
+        if (other.buckets.empty()) return;
+        grow(other.offset);
+        grow(other.offset + int(other.buckets.size()) - 1);
+        for (std::size_t i = 0; i < other.buckets.size(); i++) buckets[other.offset + i - offset] += other.buckets[i];
+    }
+
+    // q in [0, 1]
+    double quantile(double q) const {
+        long total = zeros;
+        for (long c : buckets) total += c;
+        if (total == 0) return std::nan("");
+        long rank = long(q*(total - 1));
+        if (rank < zeros) return 0.0;
+        long seen = zeros;
+        for (std::size_t i = 0; i < buckets.size(); i++) {
+            seen += buckets[i];
+            if (seen > rank) return 2.0*std::pow(gamma, int(i) + offset)/(gamma + 1.0);
+        }
+        return 2.0*std::pow(gamma, int(buckets.size()) - 1 + offset)/(gamma + 1.0);
+    }
+
+    // gamma is not saved, a sketch is loaded into one constructed with the same alpha
+    template <class Writer>
+    void save(Writer& out) const {
+        out.put(offset);
+        out.put(zeros);
+        out.put(std::uint64_t(buckets.size()));
+        for (long c : buckets) out.put(c);
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        std::uint64_t size = 0;
+        in.get(offset);
+        in.get(zeros);
+        in.get(size);
+        buckets.assign(in.count(size, sizeof(long)), 0);
+        for (long& c : buckets) in.get(c);
+    }
+
+private:
+    // make bucket index part of the dense bucket range
+    void grow(int index) {
+        if (buckets.empty()) {
+            offset = index;
+            buckets.assign(1, 0);
+        } else if (index < offset) {
+            buckets.insert(buckets.begin(), offset - index, 0);
+            offset = index;
+        } else if (index - offset >= int(buckets.size())) {
+            buckets.resize(index - offset + 1, 0);
+        }
+    }
+
+    double gamma;
+    double logGamma;
+    int offset = 0;
+    long zeros = 0;
+    std::vector<long> buckets;
+};
+
+struct EventSummary {
+    RunningMoments moments;
+    LogHistogram histogram;
+    QuantileSketch sketch;
+
+    void add(double t) {
+        moments.add(t);
+        histogram.add(t);
+        sketch.add(t);
+    }
+
+    void merge(const EventSummary& other) {
+        moments.merge(other.moments);
+        histogram.merge(other.histogram);
+        sketch.merge(other.sketch);
+    }
+
+    template <class Writer>
+    void save(Writer& out) const {
+        moments.save(out);
+        histogram.save(out);
+        sketch.save(out);
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        moments.load(in);
+        histogram.load(in);
+        sketch.load(in);
+    }
+};
+
+// Summary of all events of a run, and of each registry when perRegistry is set
+class SummaryCollector {
+public:
+    explicit SummaryCollector(bool perRegistry) : perRegistry(perRegistry) {}
+
+    void add(int g, double t) {
+        all.add(t);
+        if (perRegistry) registries[g].add(t);
+    }
+
+    void merge(const SummaryCollector& other) {
+        all.merge(other.all);
+        for (auto& [g, summary] : other.registries) registries[g].merge(summary);
+    }
+
+    // State for checkpoints (checkpoint.hpp), loaded into a collector with the same perRegistry
+    template <class Writer>
+    void save(Writer& out) const {
+        all.save(out);
+        out.put(std::uint64_t(registries.size()));
+        for (auto& [g, summary] : registries) {
+            out.put(std::int32_t(g));
+            summary.save(out);
+        }
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        std::uint64_t size = 0;
+        all.load(in);
+        in.get(size);
+        registries.clear();
+        for (std::uint64_t i = 0; i < size; i++) {
+            std::int32_t g = 0;
+            in.get(g);
+            registries[g].load(in);
+        }
+    }
+
+    // Report: a title line, one line of moments and quantiles per group, then the nonzero
+    // histogram bins of each group as "group lower upper count" (lower 0 is the underflow bin)
+    void writeReport(FILE* file, const std::string& title) const {
+        fprintf(file, "# %s\n", title.c_str());
+        fprintf(file, "# group count mean sd min p01 p10 p50 p90 p99 max\n");
+        writeMoments(file, "all", all);
+        for (auto& [g, summary] : registries) writeMoments(file, std::to_string(g), summary);
+        fprintf(file, "# group lower upper count\n");
+        writeHistogram(file, "all", all.histogram);
+        for (auto& [g, summary] : registries) writeHistogram(file, std::to_string(g), summary.histogram);
+    }
+
+    // The moments and quantiles line of all events, under the name group
+    void writeAll(FILE* file, const std::string& group) const { writeMoments(file, group, all); }
+
+private:
+    static void writeMoments(FILE* file, const std::string& group, const EventSummary& s) {
+        const RunningMoments& m = s.moments;
+        fprintf(file, "%s %li %.12g %.12g %.12g", group.c_str(), m.count, m.mean, std::sqrt(m.variance()), m.min);
+        for (double q : {0.01, 0.1, 0.5, 0.9, 0.99}) fprintf(file, " %.6g", s.sketch.quantile(q));
+        fprintf(file, " %.12g\n", m.max);
+    }
+
+    static void writeHistogram(FILE* file, const std::string& group, const LogHistogram& h) {
+        for (int i = 0; i < LogHistogram::kBins; i++) {
+            if (h.counts[i] == 0) continue;
+            double lower = i == 0 ? 0.0 : LogHistogram::lower(i);
+            double upper = i == LogHistogram::kBins - 1 ? INFINITY : LogHistogram::lower(i + 1);
+            fprintf(file, "%s %.3g %.3g %li\n", group.c_str(), lower, upper, h.counts[i]);
+        }
+    }
+
+    bool perRegistry;
+    EventSummary all;
+    std::map<int, EventSummary> registries;
+};
+
+// Stop rule of --precision: the relative half-width z sd/(mean sqrt(n)) of the confidence
+// interval of the mean time, of all events or, given the number of registries, of the events of
+// every registry. Events are independent, so the running variance of the events is the
+// variance of their mean; no group is judged before minEvents events.
+class PrecisionRule {
+public:
+    static constexpr double kZ95 = 1.959963984540054;
+    static constexpr long kMinEvents = 1000;
+
+    PrecisionRule(double target, int registries) : target(target), registries(registries) {}
+
+    void add(int g, double t) {
+        all.add(t);
+        if (registries > 0) groups[g].add(t);
+    }
+
+    // Largest relative half-width over the groups, infinite while one has too few events
+    double width() const {
+        if (registries == 0) return width(all);
+        if (int(groups.size()) < registries) return INFINITY;
+        double worst = 0.0;
+        for (auto& [g, moments] : groups) worst = std::max(worst, width(moments));
+        return worst;
+    }
+
+    bool reached() const { return width() <= target; }
+
+    template <class Writer>
+    void save(Writer& out) const {
+        all.save(out);
+        out.put(std::uint64_t(groups.size()));
+        for (auto& [g, moments] : groups) {
+            out.put(std::int32_t(g));
+            moments.save(out);
+        }
+    }
+
+    template <class Reader>
+    void load(Reader& in) {
+        std::uint64_t size = 0;
+        all.load(in);
+        in.get(size);
+        groups.clear();
+        for (std::uint64_t i = 0; i < size; i++) {
+            std::int32_t g = 0;
+            in.get(g);
+            groups[g].load(in);
+        }
+    }
+
+private:
+    static double width(const RunningMoments& m) {
+        if (m.count < kMinEvents || !(m.mean > 0.0)) return INFINITY;
+        return kZ95*std::sqrt(m.variance()/m.count)/m.mean;
+    }
+
+    double target;
+    int registries;
+    RunningMoments all;
+    std::map<int, RunningMoments> groups;
+};
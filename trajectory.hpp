@@ -0,0 +1,363 @@
+//TRAJECTORY RECORDING AND REPLAY
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+// Trace files of --trace: a header, the event records and, at the moves level, an index
+//
+//   char[8]  magic "KDNATRJ\0"
+//   uint32   version (1)
+//   uint32   headerBytes, a multiple of 8
+//   uint64   events
+//   uint64   indexOffset: events uint64 offsets of the event records (moves level), 0 when the
+//            records have the fixed width of the positions level
+//   uint32   length of the metadata text
+//   uint32   0
+//   char[]   metadata, "key=value" lines (level, mode, energy, seq, seed, ...), NUL padded
+//
+// Positions level, kPositionRecordBytes per event: int32 registry, uint32 event of the block,
+// uint64 block, float64 time. Block b drew from the RNG stream (seed, stream-base + b) from fresh
+// trajectories (runner.hpp), which is all a replay needs to simulate the event again.
+//
+// Moves level, one record per event: the nucleations and moves of the event, failed attempts
+// of the successful mode included (the zipped attempts the failed mode discards are not)
+//
+//   int32    registry
+//   uint32   segments: a nucleation and the moves after it, up to the next nucleation
+//   uint32   moves
+//   uint32   0
+//   float64  time
+//   segments x {int32 x, int32 y, uint32 first move, float32 nucleation wait}
+//   2-bit move codes, 4 per byte from the low bits, NUL padded to a multiple of 4 bytes
+//   moves x float32 waiting time
+constexpr char kTraceMagic[8] = {'K', 'D', 'N', 'A', 'T', 'R', 'J', '\0'};
+constexpr std::uint32_t kTraceVersion = 1;
+constexpr std::uint32_t kPositionRecordBytes = 24;
+
+// Move codes, in the order of the Gillespie selection
+constexpr int kFrayLeft = 0;   // kB1
+constexpr int kFrayRight = 1;  // kB2
+constexpr int kZipLeft = 2;    // kFL
+constexpr int kZipRight = 3;   // kFR
+
+// Recorder policy of Simulation without --trace: every hook is empty and the loop compiles as
+// before
+struct NoRecorder {
+    static constexpr bool enabled = false;
+    void startBlock(long) {}
+    void nucleation(int, int, double) {}
+    void move(int, double) {}
+    void event(int, double) {}
+    void discard() {}
+    void endRun() {}
+};
+
+// Bytes of a moves record with its segments and moves
+inline std::size_t traceRecordBytes(std::uint32_t segments, std::uint32_t moves) {
+    return 24 + 16*std::size_t(segments) + (std::size_t(moves) + 15)/16*4 + 4*std::size_t(moves);
+}
+
+class TraceWriter;
+
+// Recorder policy of the moves level: the moves of the current event in reused buffers,
+// appended to the records of the block when the event is recorded and handed to the writer
+// (if any) with the block number at the end of the run
+class TrajectoryRecorder {
+public:
+    static constexpr bool enabled = true;
+
+    explicit TrajectoryRecorder(TraceWriter* writer = nullptr) : writer(writer) {}
+
+    void startBlock(long b) {
+        block = b;
+        records.clear();
+        offsets.clear();
+        discard();
+    }
+
+    void nucleation(int x, int y, double wait) {
+        float w = wait;
+        std::uint32_t first = waits.size();
+        std::int32_t fields[3] = {x, y, 0};
+        std::memcpy(&fields[2], &first, 4);
+        segments.insert(segments.end(), reinterpret_cast<const char*>(fields), reinterpret_cast<const char*>(fields) + 12);
+        segments.append(reinterpret_cast<const char*>(&w), 4);
+    }
+
+    void move(int code, double wait) {
+        std::size_t n = waits.size();
+        if (n % 4 == 0) codes.push_back(0);
+        codes.back() |= std::uint8_t(code << (2*(n % 4)));
+        waits.push_back(float(wait));
+    }
+
+    void event(int g, double t) {
+        offsets.push_back(records.size());
+        std::uint32_t counts[3] = {std::uint32_t(segments.size()/16), std::uint32_t(waits.size()), 0};
+        std::int32_t registry = g;
+        records.append(reinterpret_cast<const char*>(&registry), 4);
+        records.append(reinterpret_cast<const char*>(counts), sizeof(counts));
+        records.append(reinterpret_cast<const char*>(&t), 8);
+        records += segments;
+        records.append(reinterpret_cast<const char*>(codes.data()), codes.size());
+        records.append((4 - codes.size() % 4) % 4, '\0');
+        records.append(reinterpret_cast<const char*>(waits.data()), 4*waits.size());
+        discard();
+    }
+
+    // The attempt is dropped without an event (a zipped attempt of the failed mode)
+    void discard() {
+        segments.clear();
+        codes.clear();
+        waits.clear();
+    }
+
+    inline void endRun();
+
+    // Records of the block, at offsets, for a replay without a writer
+    const std::string& blockRecords() const { return records; }
+    const std::vector<std::uint64_t>& recordOffsets() const { return offsets; }
+
+private:
+    TraceWriter* writer;
+    long block = 0;
+    std::string segments;
+    std::vector<std::uint8_t> codes;
+    std::vector<float> waits;
+    std::string records;
+    std::vector<std::uint64_t> offsets;
+};
+
+// Writes a trace file; blocks of the moves level arrive from every thread in any order and
+// are indexed by event number (block*blockEvents + event of the block) when the file is closed
+class TraceWriter {
+public:
+    TraceWriter(const std::string& fileName, bool moves, long blockEvents, std::vector<std::pair<std::string, std::string>> metadata)
+        : moves(moves), blockEvents(blockEvents) {
+        file = fopen(fileName.c_str(), "wb");
+        if (!file) throw std::runtime_error("cannot open " + fileName);
+        std::string text = std::string("level=") + (moves ? "moves" : "positions") + "\nblock-events=" + std::to_string(blockEvents) + "\n";
+        for (auto& [key, value] : metadata) text += key + "=" + value + "\n";
+        std::uint32_t textBytes = text.size();
+        std::uint32_t headerBytes = (8 + 8 + 16 + 8 + textBytes + 7)/8*8;
+        std::vector<char> header(headerBytes, '\0');
+        std::uint32_t fields[2] = {kTraceVersion, headerBytes};
+        std::memcpy(header.data(), kTraceMagic, 8);
+        std::memcpy(header.data() + 8, fields, sizeof(fields));
+        std::memcpy(header.data() + 32, &textBytes, 4);
+        std::memcpy(header.data() + 40, text.data(), textBytes);
+        fwrite(header.data(), 1, header.size(), file);
+        end = headerBytes;
+    }
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter() {
+        if (file) fclose(file);
+    }
+
+    // Positions level, in event order from the emit of the ensemble runner
+    void position(long event, int g, double t) {
+        char record[kPositionRecordBytes];
+        std::int32_t registry = g;
+        std::uint32_t index = event % blockEvents;
+        std::uint64_t block = event/blockEvents;
+        std::memcpy(record, &registry, 4);
+        std::memcpy(record + 4, &index, 4);
+        std::memcpy(record + 8, &block, 8);
+        std::memcpy(record + 16, &t, 8);
+        fwrite(record, 1, sizeof(record), file);
+        events++;
+    }
+
+    // Moves level: the records of a block at their offsets
+    void addBlock(long block, const std::string& records, const std::vector<std::uint64_t>& offsets) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fwrite(records.data(), 1, records.size(), file);
+        for (std::size_t i = 0; i < offsets.size(); i++) index[std::uint64_t(block)*blockEvents + i] = end + offsets[i];
+        end += records.size();
+    }
+
+    // Completes the header; emitted is the number of events of the run, so the blocks simulated
+    // past a --precision stop are left out of the index
+    void close(long emitted) {
+        std::uint64_t indexOffset = 0;
+        if (moves) {
+            indexOffset = end;
+            events = 0;
+            for (auto& [event, offset] : index) {
+                if (event >= std::uint64_t(emitted) || event != events) break;
+                fwrite(&offset, 8, 1, file);
+                events++;
+            }
+        }
+        std::uint64_t fields[2] = {events, indexOffset};
+        fseeko(file, 16, SEEK_SET);
+        fwrite(fields, sizeof(fields), 1, file);
+        if (fclose(file) != 0) throw std::runtime_error("cannot write the trace file");
+        file = nullptr;
+    }
+
+private:
+    FILE* file = nullptr;
+    bool moves;
+    long blockEvents;
+    std::mutex mutex;
+    std::uint64_t end = 0;
+    std::uint64_t events = 0;
+    std::map<std::uint64_t, std::uint64_t> index;
+};
+
+inline void TrajectoryRecorder::endRun() {
+    if (writer) writer->addBlock(block, records, offsets);
+}
+
+// Reads the header and records of a trace file
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& fileName) : fileName(fileName) {
+        file = fopen(fileName.c_str(), "rb");
+        if (!file) throw std::runtime_error("cannot open " + fileName);
+        char fixed[40];
+        std::uint32_t fields[2], textBytes;
+        if (fread(fixed, 1, 40, file) != 40 || std::memcmp(fixed, kTraceMagic, 8) != 0) fail();
+        std::memcpy(fields, fixed + 8, 8);
+        std::memcpy(&events, fixed + 16, 8);
+        std::memcpy(&indexOffset, fixed + 24, 8);
+        std::memcpy(&textBytes, fixed + 32, 4);
+        if (fields[0] != kTraceVersion) fail();
+        headerBytes = fields[1];
+        std::string text(textBytes, '\0');
+        if (fread(&text[0], 1, textBytes, file) != textBytes) fail();
+        std::size_t start = 0;
+        for (std::size_t end; (end = text.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::string line = text.substr(start, end - start);
+            std::size_t equals = line.find('=');
+            if (equals != std::string::npos) metadata[line.substr(0, equals)] = line.substr(equals + 1);
+        }
+    }
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    ~TraceReader() { fclose(file); }
+
+    std::uint64_t size() const { return events; }
+    bool moves() const { return indexOffset != 0; }
+
+    // Metadata value of key, empty when it is missing
+    std::string get(const std::string& key) const {
+        auto it = metadata.find(key);
+        return it == metadata.end() ? "" : it->second;
+    }
+
+    // Positions level: the block and event of the block of event k, with its registry and time
+    void position(std::uint64_t k, long& block, long& index, int& g, double& t) {
+        char record[kPositionRecordBytes];
+        check(k);
+        if (fseeko(file, headerBytes + k*kPositionRecordBytes, SEEK_SET) != 0 || fread(record, 1, sizeof(record), file) != sizeof(record)) fail();
+        std::int32_t registry;
+        std::uint32_t i;
+        std::uint64_t b;
+        std::memcpy(&registry, record, 4);
+        std::memcpy(&i, record + 4, 4);
+        std::memcpy(&b, record + 8, 8);
+        std::memcpy(&t, record + 16, 8);
+        g = registry;
+        index = i;
+        block = b;
+    }
+
+    // Moves level: the record of event k (blocks are written as they finish, so its size comes
+    // from its counts, not from the next offset)
+    std::string record(std::uint64_t k) {
+        check(k);
+        std::uint64_t offset;
+        if (fseeko(file, indexOffset + 8*k, SEEK_SET) != 0 || fread(&offset, 8, 1, file) != 1) fail();
+        std::string bytes(24, '\0');
+        if (fseeko(file, offset, SEEK_SET) != 0 || fread(&bytes[0], 1, 24, file) != 24) fail();
+        std::uint32_t counts[2];
+        std::memcpy(counts, bytes.data() + 4, 8);
+        std::size_t size = traceRecordBytes(counts[0], counts[1]);
+        if (offset + size > indexOffset) fail();
+        bytes.resize(size);
+        if (fread(&bytes[24], 1, size - 24, file) != size - 24) fail();
+        return bytes;
+    }
+
+private:
+    void check(std::uint64_t k) const {
+        if (k >= events) throw std::runtime_error("event " + std::to_string(k) + " is not in " + fileName + " (" + std::to_string(events) + " events)");
+    }
+    [[noreturn]] void fail() const { throw std::runtime_error("corrupt trace file " + fileName); }
+
+    std::string fileName;
+    FILE* file = nullptr;
+    std::uint32_t headerBytes = 0;
+    std::uint64_t events = 0;
+    std::uint64_t indexOffset = 0;
+    std::map<std::string, std::string> metadata;
+};
+
+// Writes the path of an event record of the moves level as "step xL xR hBonds t" lines, the
+// state after each nucleation and move; t sums the float32 waits, the header line has the
+// exact time of the event. A fray of the last pair melts the nucleus to xL = xR = 0.
+inline void writeTrajectory(FILE* file, const std::string& record, const std::string& prefix) {
+    auto read = [&](std::size_t offset, auto& value) {
+        if (offset + sizeof(value) > record.size()) throw std::runtime_error("corrupt trace record");
+        std::memcpy(&value, record.data() + offset, sizeof(value));
+    };
+    std::int32_t g;
+    std::uint32_t segments, moves;
+    double time;
+    read(0, g);
+    read(4, segments);
+    read(8, moves);
+    read(16, time);
+    std::size_t codes = 24 + 16*std::size_t(segments);
+    std::size_t waits = codes + (std::size_t(moves) + 15)/16*4;
+    if (traceRecordBytes(segments, moves) != record.size()) throw std::runtime_error("corrupt trace record");
+
+    fprintf(file, "%s# registry %i time %.12f segments %u moves %u\n", prefix.c_str(), g, time, segments, moves);
+    fprintf(file, "%s# step xL xR hBonds t\n", prefix.c_str());
+    int xL = 0, xR = 0, hBonds = 0;
+    double t = 0.0;
+    long step = 0;
+    std::uint32_t move = 0;
+    for (std::uint32_t s = 0; s <= segments; s++) {
+        std::uint32_t last = moves;
+        if (s < segments) read(24 + 16*std::size_t(s) + 8, last);
+        for (; move < last; move++) {
+            int code = (std::uint8_t(record[codes + move/4]) >> (2*(move % 4))) & 3;
+            float wait;
+            read(waits + 4*std::size_t(move), wait);
+            if (code == kFrayLeft) xL++, hBonds--;
+            else if (code == kFrayRight) xR--, hBonds--;
+            else if (code == kZipLeft) xL--, hBonds++;
+            else xR++, hBonds++;
+            if (hBonds == 0) xL = xR = 0;
+            t += wait;
+            fprintf(file, "%s%li %i %i %i %.12f\n", prefix.c_str(), ++step, xL, xR, hBonds, t);
+        }
+        if (s == segments) break;
+        std::int32_t x;
+        float wait;
+        read(24 + 16*std::size_t(s), x);
+        read(24 + 16*std::size_t(s) + 12, wait);
+        xL = xR = x;
+        hBonds = 1;
+        t += wait;
+        fprintf(file, "%s%li %i %i %i %.12f\n", prefix.c_str(), ++step, xL, xR, hBonds, t);
+    }
+}